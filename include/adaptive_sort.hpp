@@ -0,0 +1,92 @@
+#pragma once
+
+#include "comparison_generator.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Fast paths for input that is already largely in order
+ *
+ * A parallel pre-scan compares neighbouring records and notes where
+ * ascending runs break. Each stripe stops early once it has seen both
+ * orders and too many breaks, so unordered input costs a few hundred
+ * comparisons. Depending on what it finds:
+ * - sorted input is left alone (or copied to the output)
+ * - descending input is reversed; under a stable sort only if no two
+ *   neighbours are equal
+ * - a sorted prefix followed by a short unordered tail has the tail
+ *   sorted by the caller and merged in from the back, moving only the
+ *   records that belong after the tail's smallest
+ * - a few long ascending runs are merged in one pass with a loser tree
+ * All of these keep equal records in input order, except reversal of
+ * equal neighbours when not stable.
+ */
+class AdaptiveSort {
+public:
+    // Inputs of at most this many ascending runs are merged
+    static constexpr size_t kMaxNaturalRuns = 32;
+
+    // Unordered tails of up to 1/kTailFraction of the records are sorted
+    // separately and merged into the sorted prefix
+    static constexpr size_t kTailFraction = 8;
+
+    // Fewer neighbour comparisons than this are not split across threads
+    static constexpr size_t kMinScanStripe = 1 << 16;
+
+    // Sorts records in place
+    using SortFunction = std::function<void(uint8_t* data, size_t record_count)>;
+
+    AdaptiveSort(size_t record_length, Comparator compare, bool stable, ThreadPool& pool);
+
+    /**
+     * Sort records if their existing order allows a fast path
+     * @param output Destination for the sorted records, or nullptr to sort
+     *        in place; data is then scratch as for SortEngine::sort
+     * @param sort_tail Sorts an unordered tail in place
+     * @return false, with nothing modified, if no fast path applies
+     */
+    bool sort(uint8_t* data, uint8_t* output, size_t record_count, const SortFunction& sort_tail);
+
+    /**
+     * Whether records are in ascending key order; every stripe stops at
+     * the first descent anywhere
+     */
+    bool is_sorted(const uint8_t* data, size_t record_count) const;
+
+private:
+    struct Scan {
+        std::vector<size_t> breaks;    // Starts of runs after the first
+        bool many_breaks = false;      // More than kMaxNaturalRuns - 1 breaks
+        bool rising = false;           // Some record is below its successor
+        bool ties = false;             // Some record equals its successor
+    };
+
+    size_t record_length_;
+    Comparator compare_;
+    bool stable_;
+    ThreadPool& pool_;
+
+    uint8_t* at(uint8_t* data, size_t index) const { return data + index * record_length_; }
+
+    Scan scan(const uint8_t* data, size_t record_count) const;
+
+    void reverse(uint8_t* data, uint8_t* output, size_t record_count) const;
+
+    /**
+     * Merge a sorted tail into the sorted prefix before it
+     */
+    void merge_tail(uint8_t* data, uint8_t* output, size_t record_count, size_t prefix) const;
+
+    /**
+     * Merge consecutive ascending runs into output
+     */
+    void merge_runs(const uint8_t* data, uint8_t* output, size_t record_count,
+                    const std::vector<size_t>& breaks) const;
+};
+
+} // namespace binsort
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "group_reducer.hpp"
 #include "record.hpp"
+#include "sort_engine.hpp"
 #include <string>
 #include <vector>
 #include <optional>
@@ -9,16 +11,28 @@ namespace binsort {
 
 /**
  * Command-line argument parser
- * Syntax: binsort <input> <output> / sort(...) record(...) thread_count(...)
+ * Syntax: binsort <input>... <output> / sort(...) record(...) thread_count(...) algorithm(...)
+ *         memory(...) temp(...) io(...) limit(...) stable(...) unique(...) count(...)
+ *         merge(...)
  */
 class ArgumentParser {
 public:
     struct Arguments {
-        std::string input_file;
+        std::string input_file;  // The first of input_files
+        std::vector<std::string> input_files;
         std::string output_file;
         std::vector<KeySpec> keys;
         size_t record_length = 0;
         size_t thread_count = 0;  // 0 means auto-detect
+        SortAlgorithm algorithm = SortAlgorithm::Auto;
+        size_t memory_budget = 0;  // 0 means sort entirely in memory
+        std::string temp_directory;  // Empty means the output's directory
+        bool direct_io = false;  // Read and write with O_DIRECT instead of mapping
+        bool explicit_huge_pages = false;  // Take buffers from the hugetlbfs pool
+        size_t limit = 0;  // Emit only the first N records; 0 means all
+        bool stable = false;  // Keep equal records in input order
+        GroupReducer::Config groups;  // Duplicate removal and group counts
+        bool merge = false;  // Inputs are sorted already; merge them
     };
 
     /**
@@ -53,6 +67,22 @@ private:
      */
     static SortOrder parse_sort_order(char c);
 
+    /**
+     * Parse algorithm name: auto, quicksort, index, radix
+     */
+    static SortAlgorithm parse_algorithm(const std::string& name);
+
+    /**
+     * Parse a group count field
+     * Format: pos,len[,type] with type w (default) or W
+     */
+    static void parse_count_spec(const std::string& spec, GroupReducer::Config& groups);
+
+    /**
+     * Parse a byte count with an optional K, M, G or T suffix (powers of 1024)
+     */
+    static size_t parse_size(const std::string& value);
+
     /**
      * Extract parameter value from format: name(value)
      */
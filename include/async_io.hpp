@@ -0,0 +1,254 @@
+#pragma once
+
+#include "memory_placement.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace binsort {
+
+/**
+ * File opened for positional (offset-based) I/O
+ *
+ * Direct files bypass the page cache (O_DIRECT, FILE_FLAG_NO_BUFFERING).
+ * Their offsets and buffers must be aligned to kDirectAlignment, and so
+ * must transfer lengths except where a transfer reaches the end of the
+ * file. Such tails are padded to a whole block, so the buffer needs room
+ * for the padding (IOBuffer always has it); a padded write is trimmed off
+ * again when the file is closed.
+ */
+class IOFile {
+public:
+    enum class Mode {
+        Read,
+        Write      // Created, or truncated if it exists
+    };
+
+    static constexpr size_t kDirectAlignment = 4096;
+
+    // Path naming standard input (Read mode) or standard output (Write)
+    static constexpr const char* kStandardStream = "-";
+
+    /**
+     * @param path   File path, or kStandardStream for stdin or stdout
+     * @param direct Bypass the page cache if the filesystem allows it;
+     *               otherwise the file is opened buffered, see direct()
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    IOFile(const std::string& path, Mode mode, bool direct = false);
+    ~IOFile();
+
+    IOFile(const IOFile&) = delete;
+    IOFile& operator=(const IOFile&) = delete;
+
+    /**
+     * Blocking read; returns fewer than size bytes only at end of file
+     */
+    size_t read_at(void* buffer, size_t size, uint64_t offset);
+
+    /**
+     * Blocking write of all size bytes
+     */
+    void write_at(const void* buffer, size_t size, uint64_t offset);
+
+    /**
+     * Blocking read at the current position, for files that are not
+     * seekable(); returns fewer than size bytes only at end of stream
+     */
+    size_t read_next(void* buffer, size_t size);
+
+    /**
+     * Blocking write of all size bytes at the current position
+     */
+    void write_next(const void* buffer, size_t size);
+
+    /**
+     * Blocking read or write on a raw handle. Writes move all size bytes;
+     * reads stop at end of file or once at least required bytes are in
+     * @return bytes transferred
+     */
+    static size_t transfer_at(intptr_t handle, bool write, uint8_t* buffer,
+                              size_t size, size_t required, uint64_t offset);
+
+    const std::string& path() const { return path_; }
+
+    bool direct() const { return direct_; }
+
+    /**
+     * Current size of the file in bytes
+     */
+    uint64_t size() const;
+
+    // False for pipes and terminals: only read_next() and write_next() work
+    bool seekable() const { return seekable_; }
+
+    // File descriptor (Unix) or HANDLE (Windows)
+    intptr_t native_handle() const { return handle_; }
+
+private:
+    friend class AsyncIO;
+
+    std::string path_;
+    intptr_t handle_;
+    Mode mode_;
+    bool direct_ = false;
+    bool seekable_ = true;
+    uint64_t written_end_ = 0;   // Unpadded end of everything written
+
+    // Length to transfer for size bytes: rounded up to whole blocks if direct
+    size_t padded(size_t size) const {
+        return direct_ ? (size + kDirectAlignment - 1) / kDirectAlignment * kDirectAlignment : size;
+    }
+
+    void note_write(uint64_t end) {
+        if (end > written_end_) written_end_ = end;
+    }
+
+    // Cut padded direct writes back to written_end_
+    void trim();
+};
+
+/**
+ * Page-aligned buffer for file transfers
+ *
+ * The allocation is rounded up to whole pages, so direct transfers may pad
+ * a tail past size(). Large buffers get huge pages and NUMA interleaving
+ * from MemoryPlacement.
+ */
+class IOBuffer {
+public:
+    static constexpr size_t kAlignment = IOFile::kDirectAlignment;
+
+    IOBuffer() = default;
+    explicit IOBuffer(size_t size)
+        : data_(static_cast<uint8_t*>(MemoryPlacement::allocate(capacity(size), kAlignment)),
+                Release{capacity(size)})
+        , size_(size) {}
+
+    uint8_t* data() const { return data_.get(); }
+    size_t size() const { return size_; }
+
+private:
+    struct Release {
+        size_t bytes;
+        void operator()(uint8_t* p) const { MemoryPlacement::release(p, bytes, kAlignment); }
+    };
+
+    static size_t capacity(size_t size) {
+        return (size + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    std::unique_ptr<uint8_t[], Release> data_{nullptr, Release{0}};
+    size_t size_ = 0;
+};
+
+/**
+ * Asynchronous file I/O with several requests in flight
+ *
+ * Transfers are split into chunks of up to kChunkBytes that are queued
+ * together, so one large read or write keeps the device busy. On Linux the
+ * chunks go to an io_uring; elsewhere, or where the kernel refuses a ring,
+ * a small set of I/O threads issues them with blocking positional calls.
+ *
+ * An instance is used from one thread at a time. Buffers must stay valid
+ * until their transfer has been waited for; destroying the instance waits
+ * for whatever is still in flight.
+ */
+class AsyncIO {
+public:
+    enum class Backend {
+        IoUring,
+        Threads
+    };
+
+    static constexpr size_t kChunkBytes = 2 * 1024 * 1024;
+    static constexpr size_t kDefaultQueueDepth = 32;
+
+    /**
+     * io_uring where available, else the thread backend
+     */
+    static std::unique_ptr<AsyncIO> create(size_t queue_depth = kDefaultQueueDepth);
+
+    /**
+     * A specific backend, or nullptr if it is unavailable here
+     */
+    static std::unique_ptr<AsyncIO> create(Backend backend, size_t queue_depth);
+
+    virtual ~AsyncIO() = default;
+
+    virtual Backend backend() const = 0;
+
+    /**
+     * Queue a read of exactly size bytes
+     * @return transfer id for wait()
+     */
+    uint64_t read(IOFile& file, void* buffer, size_t size, uint64_t offset);
+
+    /**
+     * Queue a write of size bytes
+     * @return transfer id for wait()
+     */
+    uint64_t write(IOFile& file, const void* buffer, size_t size, uint64_t offset);
+
+    /**
+     * Block until a transfer has completed
+     * @throws std::runtime_error on I/O errors or a read past end of file
+     */
+    void wait(uint64_t transfer);
+
+    /**
+     * Block until every queued transfer has completed
+     */
+    void wait_all();
+
+protected:
+    struct Request {
+        bool write;
+        intptr_t handle;
+        uint8_t* buffer;
+        size_t size;
+        size_t required;         // Bytes a read needs; less than size when padded
+        uint64_t offset;
+        uint64_t tag;
+    };
+
+    struct Completion {
+        uint64_t tag;
+        size_t required;
+        size_t bytes;            // Less than required only at end of file
+        std::exception_ptr error;
+    };
+
+    /**
+     * Start a request; backends may complete it before returning
+     */
+    virtual void submit(const Request& request) = 0;
+
+    /**
+     * Next finished request, blocking until one is available
+     */
+    virtual Completion reap() = 0;
+
+    /**
+     * io_uring backend, or nullptr where the platform or kernel lacks it
+     */
+    static std::unique_ptr<AsyncIO> create_uring(size_t queue_depth);
+
+private:
+    struct Transfer {
+        size_t pending;          // Chunks not yet completed
+        bool short_read = false;
+        std::exception_ptr error;
+    };
+
+    uint64_t next_transfer_ = 1;
+    std::unordered_map<uint64_t, Transfer> transfers_;
+
+    uint64_t queue(bool write, IOFile& file, uint8_t* buffer, size_t size, uint64_t offset);
+    void complete_one();
+};
+
+} // namespace binsort
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Process-wide owner of executable memory for generated code
+ *
+ * Small functions are packed into shared chunks. Where the platform allows
+ * it, each chunk is mapped twice (a writable view and an executable view
+ * of the same pages), so new code can be installed next to code that other
+ * threads are running without ever having a writable+executable mapping.
+ * Otherwise every function gets its own pages, sealed read+exec.
+ */
+class CodeArena {
+public:
+    static CodeArena& instance();
+
+    /**
+     * Copy machine code into executable memory
+     * @return Address of the installed code (read+exec)
+     * @throws std::runtime_error if executable memory cannot be allocated
+     */
+    void* install(const void* code, size_t size);
+
+    /**
+     * Return the memory of a function obtained from install()
+     */
+    void release(void* func);
+
+    /**
+     * Size of an installed function, 0 if the address is not owned here
+     */
+    size_t size_of(const void* func) const;
+
+    /**
+     * Total bytes of executable memory currently mapped
+     */
+    size_t mapped_bytes() const;
+
+    ~CodeArena();
+
+    CodeArena(const CodeArena&) = delete;
+    CodeArena& operator=(const CodeArena&) = delete;
+
+private:
+    CodeArena() = default;
+
+    static constexpr size_t kChunkSize = 64 * 1024;
+    static constexpr size_t kAlignment = 16;
+
+    struct Chunk {
+        uint8_t* exec = nullptr;    // read+exec view
+        uint8_t* write = nullptr;   // writable view (nullptr once sealed)
+        size_t capacity = 0;
+        bool shared = false;        // dual-mapped and open for packing
+        std::map<size_t, size_t> free_blocks;  // offset -> size
+        std::map<size_t, size_t> used_blocks;  // offset -> size
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    bool dual_mapping_failed_ = false;
+
+    static std::unique_ptr<Chunk> map_shared_chunk(size_t capacity);
+    static std::unique_ptr<Chunk> map_private_chunk(const void* code, size_t size);
+    static void unmap_chunk(Chunk& chunk);
+
+    static bool allocate_block(Chunk& chunk, size_t size, size_t& offset);
+    static void free_block(Chunk& chunk, size_t offset);
+
+    Chunk* find_chunk(const void* func, size_t& offset) const;
+};
+
+} // namespace binsort
@@ -10,8 +10,22 @@ namespace binsort {
 /**
  * Function signature for generated comparison function
  * Returns: < 0 if a < b, 0 if a == b, > 0 if a > b
+ * The context pointer carries per-comparator state for interpreted
+ * comparators; JIT-generated code ignores it.
  */
-using ComparisonFunc = int(*)(const uint8_t* a, const uint8_t* b);
+using ComparisonFunc = int(*)(const uint8_t* a, const uint8_t* b, const void* context);
+
+/**
+ * Comparison function bound to its context
+ */
+struct Comparator {
+    ComparisonFunc func = nullptr;
+    const void* context = nullptr;
+
+    int operator()(const uint8_t* a, const uint8_t* b) const {
+        return func(a, b, context);
+    }
+};
 
 /**
  * JIT comparison function generator
@@ -22,9 +36,13 @@ class ComparisonGenerator {
 public:
     /**
      * Generate a comparison function for the given key specifications
+     * Generated code is cached by (keys, record_length); requesting the
+     * same layout again returns the existing function without codegen.
+     * Every successful call must be paired with free_function().
      * @param keys Vector of key specifications
      * @param record_length Length of each record
-     * @return Function pointer to the generated comparison code
+     * @return Function pointer to the generated comparison code, or
+     *         nullptr if JIT is unavailable or the layout cannot be compiled
      */
     static ComparisonFunc generate(
         const std::vector<KeySpec>& keys,
@@ -37,17 +55,22 @@ public:
     static bool is_available();
 
     /**
-     * Free the memory allocated for a generated function
+     * Release a function returned by generate()
+     * The code stays cached for reuse until it is evicted from the idle
+     * set; functions not produced by the JIT are ignored.
      */
     static void free_function(ComparisonFunc func);
 
+    /**
+     * Maximum number of unreferenced comparators kept for reuse
+     */
+    static constexpr size_t kMaxIdleFunctions = 32;
+
 private:
+    // Code is assembled here, then installed into the CodeArena
     struct CodeBuffer {
-        void* memory = nullptr;
-        size_t size = 0;
-        size_t capacity = 0;
-
-        ~CodeBuffer();
+        std::vector<uint8_t> bytes;
+        size_t size() const { return bytes.size(); }
     };
 
     // Emit x64 assembly instructions
@@ -58,27 +81,73 @@ private:
         const KeySpec& spec,
         size_t record_length
     );
+
+    /**
+     * Emit compare of one 1/2/4/8-byte field at the given offset of both
+     * records, returning -1/+1 from the function if the values differ
+     */
+    static void emit_field_comparison(
+        CodeBuffer& code,
+        size_t offset,
+        size_t width,
+        KeyType type,
+        SortOrder order
+    );
+
+    // Instruction encoders (registers use x64 ModRM numbering, 0-15)
+    static void emit_rex(CodeBuffer& code, bool wide, uint8_t reg, uint8_t rm);
+    static void emit_mem_operand(CodeBuffer& code, uint8_t reg, uint8_t base, size_t disp);
+    static void emit_load(CodeBuffer& code, uint8_t dst, uint8_t base, size_t disp, size_t width);
+    static void emit_byteswap(CodeBuffer& code, uint8_t reg, size_t width);
+    static void emit_sign_extend16(CodeBuffer& code, uint8_t reg);
+    static void emit_float_to_ordered(CodeBuffer& code, uint8_t reg, bool wide);
+    static void emit_reg_op(CodeBuffer& code, uint8_t opcode, bool wide, uint8_t dst, uint8_t src);
+    static void emit_shift(CodeBuffer& code, uint8_t ext, bool wide, uint8_t reg, uint8_t amount);
     static void emit_byte(CodeBuffer& code, uint8_t byte);
     static void emit_bytes(CodeBuffer& code, const void* bytes, size_t count);
-    static void ensure_capacity(CodeBuffer& code, size_t required);
-    static void make_executable(CodeBuffer& code);
+    static ComparisonFunc compile(
+        const std::vector<KeySpec>& keys,
+        size_t record_length
+    );
 };
 
 /**
  * Fallback interpreter-based comparator
  * Used when JIT is not available or as a reference implementation
+ *
+ * The key list is compiled once into a flat plan of type-specialized field
+ * comparisons, so compare() does no allocation and touches no shared state;
+ * each engine owns its own instance and passes it as the context.
  */
 class InterpretedComparator {
 public:
-    explicit InterpretedComparator(const std::vector<KeySpec>& keys)
-        : keys_(keys) {}
+    /**
+     * @throws std::invalid_argument for unsupported key specifications
+     */
+    explicit InterpretedComparator(const std::vector<KeySpec>& keys);
 
     int compare(const uint8_t* a, const uint8_t* b) const;
 
-    static ComparisonFunc wrap(const std::vector<KeySpec>& keys);
+    /**
+     * Bind this comparator as a Comparator
+     * Single-key plans bind a fully specialized function.
+     * The comparator must outlive the returned value.
+     */
+    Comparator bind() const;
 
 private:
-    std::vector<KeySpec> keys_;
+    using FieldCompare = int(*)(const uint8_t* a, const uint8_t* b, size_t length);
+
+    struct Step {
+        size_t offset;
+        size_t length;
+        FieldCompare compare;
+        ComparisonFunc single;  // Whole-record compare when this is the only key
+    };
+
+    std::vector<Step> steps_;
+
+    static int compare_thunk(const uint8_t* a, const uint8_t* b, const void* context);
 };
 
 } // namespace binsort
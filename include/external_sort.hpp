@@ -0,0 +1,121 @@
+#pragma once
+
+#include "group_reducer.hpp"
+#include "sort_engine.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace binsort {
+
+class AsyncIO;
+
+/**
+ * External merge sort for files larger than memory
+ *
+ * Reads the input in runs of a quarter of the memory budget and sorts each
+ * run with the SortEngine before spilling it to a temp directory. File I/O
+ * goes through AsyncIO, so the next run is read and the previous one
+ * written while the current one is sorted. Runs are then merged with a
+ * loser tree, as many at a time as the budget allows with large
+ * double-buffered reads and writes, in as many passes as needed; the last
+ * pass writes the output file. A file that fits in a single run is sorted
+ * and written directly without temp files.
+ *
+ * Either side may be "-" or a pipe: a stream input is read run by run
+ * until it ends, and the last merge pass writes a stream output in order,
+ * starting as soon as that pass begins. The input is fully read before
+ * the output is opened, so input and output may be the same file.
+ *
+ * Duplicate removal and group counts are applied as the final merge pass
+ * (or the single run) writes the output, so dropped records never reach
+ * it. Keeping the first or last of a group needs a stable engine.
+ *
+ * merge() skips run formation and merges files that are already sorted,
+ * checking their order as it reads them.
+ */
+class ExternalSort {
+public:
+    struct Config {
+        size_t record_length;
+        size_t memory_budget;          // Bytes for record buffers
+        std::string temp_directory;    // Empty: the output file's directory
+        size_t min_merge_buffer = 1 << 20;  // Smallest read buffer per merged run
+        bool direct_io = false;        // Bypass the page cache for every file
+        GroupReducer::Config groups;   // Reduction of equal-key groups in the output
+    };
+
+    struct Stats {
+        size_t runs = 0;               // Sorted runs spilled to disk
+        size_t merge_passes = 0;       // Passes over the data after run formation
+        size_t output_records = 0;     // Records written after group reduction
+    };
+
+    ExternalSort(const Config& config, SortEngine& engine);
+
+    // Removes any runs left behind by a failed sort
+    ~ExternalSort();
+
+    ExternalSort(const ExternalSort&) = delete;
+    ExternalSort& operator=(const ExternalSort&) = delete;
+
+    /**
+     * Sort input into output; either may be IOFile::kStandardStream
+     * @throws std::runtime_error on I/O failure or misaligned input
+     */
+    Stats sort(const std::string& input, const std::string& output);
+
+    /**
+     * Merge sorted files into output, which may be IOFile::kStandardStream
+     * Equal records are taken from earlier inputs first.
+     * @throws std::runtime_error if an input is out of order, misaligned
+     *         or the output itself, or on I/O failure
+     */
+    Stats merge(const std::vector<std::string>& inputs, const std::string& output);
+
+private:
+    Config config_;
+    SortEngine& engine_;
+    std::unique_ptr<AsyncIO> io_;
+    std::string run_prefix_;
+    size_t next_run_ = 0;
+    std::vector<std::string> live_runs_;
+
+    /**
+     * Read, sort and spill runs
+     * @return run paths in input order; empty if the whole input was
+     *         sorted straight into output, with stats.output_records set
+     */
+    std::vector<std::string> form_runs(const std::string& input, const std::string& output, Stats& stats);
+
+    /**
+     * Merge runs in as many passes as the fan-in needs, the last one into
+     * output; runs this sort did not create are left in place
+     */
+    void merge_all(std::vector<std::string> runs, const std::string& output, Stats& stats);
+
+    /**
+     * Merge runs into a single file with a loser tree, reducing groups
+     * when final
+     * @return Records written
+     */
+    size_t merge_runs(const std::vector<std::string>& runs, const std::string& output, bool final);
+
+    // Granularity of run and buffer sizes: whole records, and whole
+    // direct I/O blocks when the page cache is bypassed
+    size_t io_unit() const;
+
+    // Runs merged at once: every run and the output get a buffer of at
+    // least min_merge_buffer bytes, and stay below RLIMIT_NOFILE
+    size_t fan_in() const;
+
+    // Temp directory left empty: the output's, or the system's for "-"
+    void choose_temp_directory(const std::string& output);
+
+    std::string new_run_path();
+    bool owns_run(const std::string& path) const;
+    void remove_run(const std::string& path);
+};
+
+} // namespace binsort
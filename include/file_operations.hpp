@@ -20,6 +20,13 @@ public:
      */
     static bool file_exists(const std::string& filepath);
 
+    /**
+     * Check if a path is "-" (standard input or output) or an existing
+     * file that is not a regular file, such as a named pipe; streams
+     * cannot be mapped and are only read and written sequentially
+     */
+    static bool is_stream(const std::string& filepath);
+
     /**
      * Check if two paths refer to the same file
      */
@@ -30,6 +37,10 @@ public:
 
     /**
      * Copy file from source to destination
+     *
+     * On Linux the kernel copies the data where it can: a reflink
+     * (FICLONE) on filesystems that share extents, else copy_file_range,
+     * else sendfile. Anything left is copied through asynchronous I/O.
      * @param src Source file path
      * @param dst Destination file path
      * @param size Expected size of the file
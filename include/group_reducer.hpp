@@ -0,0 +1,78 @@
+#pragma once
+
+#include "comparison_generator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Records kept from each group of records with equal keys
+ */
+enum class DuplicateMode {
+    KeepAll,
+    KeepFirst,
+    KeepLast
+};
+
+/**
+ * Reduction of sorted records to one record per key group
+ *
+ * Fed records in sorted order, it holds a copy of the current group's
+ * kept record and emits it once a record with a different key arrives,
+ * optionally with the group's size stored in a count field. Each record
+ * costs one comparison, so the reduction runs inside whatever pass writes
+ * the output instead of as a pass of its own. First and last refer to
+ * input order only if the records were sorted stably.
+ */
+class GroupReducer {
+public:
+    struct Config {
+        DuplicateMode duplicates = DuplicateMode::KeepAll;
+
+        // Field that receives the number of records in the group, as an
+        // unsigned integer saturating at its maximum; length 0 for none.
+        // Counting keeps one record per group, the first unless KeepLast
+        size_t count_offset = 0;
+        size_t count_length = 0;
+        bool count_big_endian = false;
+
+        bool active() const {
+            return duplicates != DuplicateMode::KeepAll || count_length > 0;
+        }
+    };
+
+    GroupReducer(size_t record_length, Comparator compare, const Config& config);
+
+    /**
+     * Take the next record in sorted order
+     * @param out Receives the previous group's record when record starts
+     *        a new group; may be where a later record is read from
+     * @return true if a record was written to out
+     */
+    bool add(const uint8_t* record, uint8_t* out);
+
+    /**
+     * Emit the last group's record, if any, and start over
+     * @return true if a record was written to out
+     */
+    bool finish(uint8_t* out);
+
+    /**
+     * Reduce an array of sorted records in place
+     * @return Number of records kept at the start of data
+     */
+    size_t reduce(uint8_t* data, size_t record_count);
+
+private:
+    size_t record_length_;
+    Comparator compare_;
+    Config config_;
+    std::vector<uint8_t> kept_;
+    uint64_t group_size_ = 0;      // 0 while there is no current group
+
+    void store_count(uint8_t* record) const;
+};
+
+} // namespace binsort
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "record.hpp"
+#include "key_normalizer.hpp"
+#include "thread_pool.hpp"
+#include "memory_placement.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Key-prefix + index sort for wide records
+ *
+ * Instead of swapping whole records, sorts a compact array of
+ * (normalized key prefix, record index) entries and then moves every
+ * record exactly once. Keys wider than the 8-byte prefix are normalized
+ * into a side buffer and prefix ties are broken with memcmp, so the
+ * records themselves are never read during the sort. Equal keys are
+ * ordered by record index, which makes the sort stable.
+ */
+class KeyIndexSort {
+public:
+    struct Entry {
+        uint64_t prefix;   // First 8 normalized key bytes, compares as unsigned
+        uint64_t index;    // Record number in the input
+    };
+
+    // Sized like the input, so placed for huge pages and NUMA interleave
+    using Entries = PlacedVector<Entry>;
+
+    /**
+     * Entry sorts of at least this many entries on more than one thread
+     * sort per-thread runs and merge them; below it the task and merge
+     * overhead outweighs the split
+     */
+    static constexpr size_t kParallelMinEntries = 1 << 11;
+
+    KeyIndexSort(
+        size_t record_length,
+        const std::vector<KeySpec>& keys,
+        ThreadPool& pool
+    );
+
+    /**
+     * Sort records in-place
+     * @param data Pointer to the start of record data
+     * @param record_count Number of records to sort
+     */
+    void sort(uint8_t* data, size_t record_count);
+
+    /**
+     * Sort records from input into output; the input is not modified
+     */
+    void sort(const uint8_t* input, uint8_t* output, size_t record_count);
+
+    /**
+     * Move records into the order given by sorted entries, following
+     * permutation cycles with a single record of scratch space
+     * Entry indices are overwritten.
+     */
+    static void permute(uint8_t* data, size_t record_length, Entries& entries);
+
+    /**
+     * Copy records into output in the order given by sorted entries
+     */
+    static void gather(
+        const uint8_t* input,
+        uint8_t* output,
+        size_t record_length,
+        const Entries& entries,
+        ThreadPool& pool
+    );
+
+private:
+    size_t record_length_;
+    KeyNormalizer normalizer_;
+    ThreadPool& pool_;
+
+    // Normalized keys past the prefix (key_width - 8 bytes per record),
+    // only used when the prefix does not cover the key
+    PlacedVector<uint8_t> tails_;
+    size_t tail_width_ = 0;
+
+    bool less(const Entry& a, const Entry& b) const;
+
+    void build_entries(const uint8_t* data, Entries& entries);
+    void sort_entries(Entries& entries) const;
+};
+
+} // namespace binsort
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "record.hpp"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace binsort {
+namespace key_compare {
+
+/**
+ * Building blocks for comparing one key field of two records with the
+ * key's type, width and order fixed at compile time
+ * Shared by InterpretedComparator and the specialized layouts.
+ */
+
+template <size_t N>
+struct UnsignedOf;
+template <> struct UnsignedOf<2> { using type = uint16_t; using signed_type = int16_t; };
+template <> struct UnsignedOf<4> { using type = uint32_t; using signed_type = int32_t; };
+template <> struct UnsignedOf<8> { using type = uint64_t; using signed_type = int64_t; };
+
+template <size_t N>
+inline typename UnsignedOf<N>::type byteswap(typename UnsignedOf<N>::type value) {
+    if constexpr (N == 2) return __builtin_bswap16(value);
+    else if constexpr (N == 4) return __builtin_bswap32(value);
+    else return __builtin_bswap64(value);
+}
+
+// Load a numeric key as a signed integer with the key's ordering
+template <KeyType Type, size_t N>
+inline int64_t load_ordered(const uint8_t* ptr) {
+    typename UnsignedOf<N>::type raw;
+    std::memcpy(&raw, ptr, N);
+
+    constexpr bool stored_big = (Type == KeyType::BigEndianInt);
+    constexpr bool native_big = (std::endian::native == std::endian::big);
+    if constexpr (stored_big != native_big) {
+        raw = byteswap<N>(raw);
+    }
+
+    int64_t value = static_cast<typename UnsignedOf<N>::signed_type>(raw);
+    if constexpr (Type == KeyType::LittleEndianFloat) {
+        // IEEE 754 totalOrder, as in RecordView::extract_key
+        value ^= static_cast<int64_t>(static_cast<uint64_t>(value >> 63) >> 1);
+    }
+    return value;
+}
+
+template <SortOrder Order>
+inline int apply_order(int cmp) {
+    return Order == SortOrder::Ascending ? cmp : -cmp;
+}
+
+template <KeyType Type, size_t N, SortOrder Order>
+inline int compare_numeric(const uint8_t* a, const uint8_t* b) {
+    const int64_t va = load_ordered<Type, N>(a);
+    const int64_t vb = load_ordered<Type, N>(b);
+    return apply_order<Order>((va > vb) - (va < vb));
+}
+
+template <SortOrder Order>
+inline int compare_chars(const uint8_t* a, const uint8_t* b, size_t length) {
+    const int cmp = std::memcmp(a, b, length);
+    return apply_order<Order>((cmp > 0) - (cmp < 0));
+}
+
+} // namespace key_compare
+} // namespace binsort
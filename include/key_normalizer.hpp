@@ -0,0 +1,85 @@
+#pragma once
+
+#include "record.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Normalized binary key encoding
+ *
+ * Rewrites a compound key list into one byte string whose memcmp order is
+ * the sort order:
+ * - integers are stored big-endian with the sign bit flipped
+ * - floats are mapped to IEEE 754 totalOrder (negatives fully inverted,
+ *   positives get the sign bit set), then stored big-endian
+ * - character keys are copied as is
+ * - every byte of a descending key is inverted
+ *
+ * Keys up to 8 bytes wide therefore compare as a single unsigned 64-bit
+ * integer (see prefix()), longer ones with memcmp.
+ */
+class KeyNormalizer {
+public:
+    /**
+     * @throws std::invalid_argument for unsupported key specifications
+     */
+    explicit KeyNormalizer(const std::vector<KeySpec>& keys);
+
+    /**
+     * Length of the normalized key (sum of all key lengths)
+     */
+    size_t key_width() const { return key_width_; }
+
+    /**
+     * Write the normalized key of a record
+     * @param out Buffer of at least key_width() bytes
+     */
+    void normalize(const uint8_t* record, uint8_t* out) const;
+
+    /**
+     * First 8 normalized bytes as a big-endian integer, zero-padded
+     * Unsigned comparison of prefixes agrees with the key order; equal
+     * prefixes mean equal keys when key_width() <= 8.
+     */
+    uint64_t prefix(const uint8_t* record) const;
+
+    bool prefix_is_exact() const { return key_width_ <= 8; }
+
+    /**
+     * Locate the record byte behind a normalized key byte
+     * normalized[position] == record[offset] ^ mask for integer and
+     * character keys; float keys are not byte-local.
+     * @return false if position is beyond the key or inside a float key
+     */
+    bool byte_source(size_t position, size_t& offset, uint8_t& mask) const;
+
+private:
+    enum class Kind : uint8_t {
+        Bytes,        // Copy as is
+        LittleInt,    // Byte-swap, flip sign bit
+        BigInt,       // Flip sign bit
+        LittleFloat   // Total order, byte-swap
+    };
+
+    struct Step {
+        size_t src_offset;
+        size_t dst_offset;
+        size_t length;
+        Kind kind;
+        bool descending;
+    };
+
+    std::vector<Step> steps_;
+    size_t key_width_ = 0;
+
+    /**
+     * Normalize only the steps that start before limit; character keys
+     * are truncated at limit, numeric keys are always written whole
+     */
+    void normalize_until(const uint8_t* record, uint8_t* out, size_t limit) const;
+};
+
+} // namespace binsort
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "comparison_generator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Tournament (loser) tree over k sorted record sources
+ *
+ * Holds the current head record of each source and yields the smallest
+ * in O(log k) comparisons per record. Exhausted sources are represented
+ * by nullptr heads. Equal records are taken from the lower-numbered
+ * source first, so merging adjacent runs is stable.
+ */
+class LoserTree {
+public:
+    LoserTree(size_t source_count, Comparator compare);
+
+    /**
+     * Set the first record of every source and build the tree
+     * @param heads One pointer per source, nullptr if the source is empty
+     */
+    void reset(const std::vector<const uint8_t*>& heads);
+
+    /**
+     * True when every source is exhausted
+     */
+    bool empty() const { return heads_[tree_[0]] == nullptr; }
+
+    /**
+     * Source holding the smallest head record
+     */
+    size_t winner() const { return tree_[0]; }
+
+    const uint8_t* winner_record() const { return heads_[tree_[0]]; }
+
+    /**
+     * Advance the winning source to its next record (nullptr when it is
+     * exhausted) and replay its path to the root
+     */
+    void replace_winner(const uint8_t* next);
+
+private:
+    size_t k_;
+    Comparator compare_;
+    std::vector<const uint8_t*> heads_;
+    std::vector<size_t> tree_;  // tree_[0]: winner, tree_[1..k-1]: losers
+
+    // Whether source a's head must be emitted before source b's
+    bool beats(size_t a, size_t b) const;
+
+    size_t build(size_t node);
+};
+
+} // namespace binsort
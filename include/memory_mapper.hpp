@@ -1,5 +1,6 @@
 #pragma once
 
+#include "memory_placement.hpp"
 #include <cstddef>
 #include <string>
 #include <memory>
@@ -14,13 +15,14 @@ class MemoryMapper {
 public:
     enum class Mode {
         ReadOnly,
-        ReadWrite
+        ReadWrite,
+        CopyOnWrite   // Writable private view; the file is never modified
     };
 
     /**
      * Map a file into memory
      * @param filepath Path to the file
-     * @param mode Mapping mode (ReadOnly or ReadWrite)
+     * @param mode Mapping mode (ReadOnly, ReadWrite or CopyOnWrite)
      * @throws std::runtime_error on failure
      */
     MemoryMapper(const std::string& filepath, Mode mode);
@@ -49,12 +51,28 @@ public:
      */
     size_t size() const noexcept { return size_; }
 
+    /**
+     * Hint how the mapping is about to be accessed, e.g. WillNeed before a
+     * sort touches every page, DontNeed once scratch contents are spent
+     */
+    void advise(MemoryPlacement::Access access) noexcept {
+        MemoryPlacement::advise(data_, size_, access);
+    }
+
     /**
      * Sync changes to disk (for ReadWrite mode)
      * @param async If true, return immediately; if false, wait for completion
      */
     void sync(bool async = false);
 
+    /**
+     * Sync the first length bytes, unmap and cut the file to length
+     * (for ReadWrite mode). Dirty pages past length are dropped without
+     * being written. The mapper is empty afterwards.
+     * @throws std::runtime_error on failure
+     */
+    void truncate(size_t length);
+
 private:
     void* data_ = nullptr;
     size_t size_ = 0;
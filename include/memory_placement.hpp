@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Placement of large sort buffers in physical memory
+ *
+ * Buffers of at least kLargeBytes are mapped directly rather than taken
+ * from the heap, as transparent huge pages on a 2 MiB aligned mapping, or
+ * from the reserved hugetlbfs pool once set_explicit_huge_pages() opts
+ * in (that pool is often reserved for another service). On machines
+ * with several NUMA nodes their pages are interleaved across all nodes,
+ * so sorts use the bandwidth of every socket instead of the one that
+ * first touched the buffer. No node owns a partition of an interleaved
+ * buffer, so pool workers are left unpinned and free to steal across
+ * nodes. NUMA placement uses the raw system calls; libnuma is not needed.
+ */
+class MemoryPlacement {
+public:
+    static constexpr size_t kHugePageBytes = 2 * 1024 * 1024;
+    static constexpr size_t kLargeBytes = kHugePageBytes;
+
+    /**
+     * Expected access to a range, passed on to madvise()
+     */
+    enum class Access {
+        Normal,
+        Sequential,   // Read ahead aggressively, drop pages behind
+        Random,       // No read-ahead
+        WillNeed,     // Start reading the range in now
+        DontNeed      // Contents may be discarded
+    };
+
+    /**
+     * Allocate bytes aligned to at least alignment
+     * @throws std::bad_alloc
+     */
+    static void* allocate(size_t bytes, size_t alignment);
+
+    /**
+     * Release memory from allocate() with the same size and alignment
+     */
+    static void release(void* data, size_t bytes, size_t alignment) noexcept;
+
+    /**
+     * Try the reserved 2 MiB hugetlbfs pool before transparent huge pages
+     * for later allocations; off by default
+     */
+    static void set_explicit_huge_pages(bool enabled) noexcept;
+
+    /**
+     * Hint how a range will be accessed; failures are ignored
+     */
+    static void advise(void* data, size_t bytes, Access access) noexcept;
+
+    /**
+     * Online NUMA nodes; 1 where there is no NUMA information
+     */
+    static size_t node_count();
+};
+
+/**
+ * Standard allocator over MemoryPlacement, for vectors that can grow to
+ * the size of the input
+ */
+template <typename T>
+class PlacedAllocator {
+public:
+    using value_type = T;
+
+    PlacedAllocator() = default;
+    template <typename U>
+    PlacedAllocator(const PlacedAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(MemoryPlacement::allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* data, size_t count) noexcept {
+        MemoryPlacement::release(data, count * sizeof(T), alignof(T));
+    }
+
+    friend bool operator==(const PlacedAllocator&, const PlacedAllocator&) { return true; }
+};
+
+template <typename T>
+using PlacedVector = std::vector<T, PlacedAllocator<T>>;
+
+} // namespace binsort
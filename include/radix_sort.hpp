@@ -0,0 +1,64 @@
+#pragma once
+
+#include "record.hpp"
+#include "key_normalizer.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Parallel LSD radix sort for keys whose normalized width is <= 8 bytes
+ *
+ * Sorts on the normalized key prefix one byte digit at a time. A single
+ * parallel histogram pass counts every digit up front so that digits
+ * with only one value are skipped; each remaining pass counts per thread
+ * and scatters through per-thread write-combining buffers. Narrow records
+ * are scattered directly, wider ones as (key, index) pairs followed by a
+ * single permutation of the records. The sort is stable.
+ */
+class RadixSort {
+public:
+    RadixSort(
+        size_t record_length,
+        const std::vector<KeySpec>& keys,
+        ThreadPool& pool
+    );
+
+    /**
+     * Whether the key list fits in a single 64-bit normalized key
+     */
+    static bool supports(const std::vector<KeySpec>& keys);
+
+    /**
+     * Sort records in-place
+     * @param data Pointer to the start of record data
+     * @param record_count Number of records to sort
+     */
+    void sort(uint8_t* data, size_t record_count);
+
+    /**
+     * Sort records from input into output
+     * The input serves as the second ping-pong buffer and is left in
+     * unspecified order.
+     */
+    void sort(uint8_t* input, uint8_t* output, size_t record_count);
+
+    // Records up to this length are moved directly in every pass
+    static constexpr size_t kDirectMaxRecordLength = 32;
+    // Bytes buffered per bucket and thread before writing out
+    static constexpr size_t kWriteCombineBytes = 256;
+
+private:
+    size_t record_length_;
+    KeyNormalizer normalizer_;
+    ThreadPool& pool_;
+
+    // A null output sorts in place
+    void sort_records(uint8_t* data, uint8_t* output, size_t record_count);
+    void sort_pairs(uint8_t* data, uint8_t* output, size_t record_count);
+};
+
+} // namespace binsort
@@ -52,6 +52,8 @@ public:
     /**
      * Extract a key value for comparison
      * Returns a signed 64-bit integer for all numeric types
+     * Float keys are mapped to an integer that orders like IEEE 754
+     * totalOrder (-NaN < -inf < -0 < +0 < +inf < +NaN)
      * For character keys, performs byte-wise comparison
      */
     int64_t extract_key(const KeySpec& spec) const;
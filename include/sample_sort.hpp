@@ -0,0 +1,89 @@
+#pragma once
+
+#include "comparison_generator.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Parallel sample sort over fixed-size records
+ *
+ * Splitters are picked from an oversampled random sample and stored as an
+ * implicit binary search tree, which every thread walks branchlessly to
+ * classify its stripe of records into up to kMaxBuckets buckets. Records
+ * are then moved so each bucket is contiguous and the buckets are sorted
+ * independently as pool tasks; no merge is needed.
+ *
+ * In place, the distribution follows IPS4o: each thread collects records
+ * in per-bucket buffer blocks and writes full blocks back into the part of
+ * its stripe it has already read, the blocks are permuted into their
+ * bucket's area, and partial blocks fill the remaining gaps. Out of
+ * place, records are scattered straight from input to output.
+ */
+class SampleSort {
+public:
+    static constexpr size_t kMaxBuckets = 256;
+
+    // Sample records per bucket
+    static constexpr size_t kOversampling = 16;
+
+    // Aim for buckets of at least this many records
+    static constexpr size_t kMinBucketRecords = 4096;
+
+    // Size of the per-bucket buffers used by the in-place distribution
+    static constexpr size_t kBlockBytes = 2048;
+
+    // In-place sort of one bucket, forking on the pool when it is large
+    using BucketSort = void (*)(uint8_t* data, size_t record_count, ThreadPool* pool);
+
+    /**
+     * @param bucket_sort Sorts each bucket instead of RecordQuickSort when
+     *        given, e.g. a specialized layout's sort
+     */
+    SampleSort(size_t record_length, Comparator compare, ThreadPool& pool, BucketSort bucket_sort = nullptr);
+
+    /**
+     * Sort records in place
+     */
+    void sort(uint8_t* data, size_t record_count);
+
+    /**
+     * Sort records from input into output; the input is not modified
+     */
+    void sort(const uint8_t* input, uint8_t* output, size_t record_count);
+
+private:
+    size_t record_length_;
+    Comparator compare_;
+    ThreadPool& pool_;
+    BucketSort bucket_sort_;
+
+    size_t bucket_count_ = 0;
+    size_t tree_levels_ = 0;
+    // Splitter records in heap order; node 1 is the root, node 0 unused
+    std::vector<uint8_t> tree_;
+
+    const uint8_t* splitter(size_t node) const {
+        return tree_.data() + node * record_length_;
+    }
+
+    /**
+     * Pick the bucket count and splitters from a sample of the input
+     */
+    void build_tree(const uint8_t* data, size_t record_count);
+
+    /**
+     * Bucket number of each of count consecutive records
+     */
+    void classify(const uint8_t* records, size_t count, uint8_t* buckets) const;
+
+    /**
+     * Sort every bucket [starts[b], starts[b + 1]) as a separate task
+     */
+    void sort_buckets(uint8_t* data, const std::vector<size_t>& starts);
+};
+
+} // namespace binsort
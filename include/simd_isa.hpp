@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace binsort {
+namespace simd {
+
+/**
+ * Kernel entry points compiled once per instruction set level
+ *
+ * Each namespace below lives in a translation unit built for that
+ * level (baseline x86-64-v2, v3 with AVX2, v4 with AVX-512) and must
+ * only be called once the CPU is known to support it (see
+ * detected_simd_level()). So that no code built for a higher level ends
+ * up in a shared inline function, these units use nothing but
+ * intrinsics, memcpy and the plain types declared here.
+ *
+ * Entries are (prefix, index) pairs of uint64_t, laid out like
+ * KeyIndexSort::Entry.
+ */
+
+// Where the 8 prefix bytes of a record come from
+struct GatherPlan {
+    size_t window = 0;          // Record offset of a 16-byte load
+    uint8_t shuffle[16] = {};   // Little-endian prefix byte i = load[shuffle[i]], 0x80 for zero
+    uint8_t flip[16] = {};      // XORed in after the shuffle
+};
+
+namespace baseline {
+
+/**
+ * Add the histogram of bytes[i * stride] ^ mask for i < count
+ */
+void count_bytes(const uint8_t* bytes, size_t stride, size_t count, uint8_t mask, size_t* histogram);
+
+/**
+ * Add the histograms of all 8 bytes of the native uint64_t key at the
+ * start of each item; histograms holds 8 x 256 counters, byte d of the
+ * key (from the least significant) counted at 256 * d
+ */
+void count_key_bytes(const uint8_t* items, size_t item_size, size_t count, size_t* histograms);
+
+} // namespace baseline
+
+namespace avx2 {
+
+void count_bytes(const uint8_t* bytes, size_t stride, size_t count, uint8_t mask, size_t* histogram);
+void count_key_bytes(const uint8_t* items, size_t item_size, size_t count, size_t* histograms);
+
+/**
+ * Build entries for records [begin, end), entries[0] for record begin,
+ * as far as the window load stays inside data; returns the first record
+ * not done
+ */
+size_t gather_prefixes(const GatherPlan& plan, const uint8_t* data, size_t record_length,
+                       size_t record_count, size_t begin, size_t end, uint64_t* entries);
+
+/**
+ * Partition count >= 4 entries around a pivot entry not necessarily
+ * among them; returns the number of entries that sort before it, which
+ * end up first
+ */
+size_t partition_entries(uint64_t* entries, size_t count, uint64_t prefix, uint64_t index);
+
+} // namespace avx2
+
+namespace avx512 {
+
+void count_bytes(const uint8_t* bytes, size_t stride, size_t count, uint8_t mask, size_t* histogram);
+void count_key_bytes(const uint8_t* items, size_t item_size, size_t count, size_t* histograms);
+
+size_t gather_prefixes(const GatherPlan& plan, const uint8_t* data, size_t record_length,
+                       size_t record_count, size_t begin, size_t end, uint64_t* entries);
+
+// count >= 8
+size_t partition_entries(uint64_t* entries, size_t count, uint64_t prefix, uint64_t index);
+
+} // namespace avx512
+
+} // namespace simd
+} // namespace binsort
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "index_sort.hpp"
+#include "key_normalizer.hpp"
+#include "simd_isa.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace binsort {
+
+/**
+ * Instruction set levels of the kernels, in increasing order
+ *
+ * The build targets the Scalar level (x86-64-v2 on x64); kernels for the
+ * others are compiled for them separately and picked at run time.
+ */
+enum class SimdLevel : uint8_t {
+    Scalar,   // Portable C++, or x86-64-v2
+    AVX2,     // x86-64-v3: AVX2, BMI1/2, FMA, LZCNT, MOVBE
+    AVX512    // x86-64-v4: AVX-512 F, BW, CD, DQ, VL
+};
+
+/**
+ * Best level this CPU and OS support, detected once through CPUID
+ * The BINSORT_SIMD environment variable (scalar, avx2 or avx512) caps
+ * it, e.g. to compare levels on one machine.
+ */
+SimdLevel detected_simd_level();
+
+const char* simd_level_name(SimdLevel level);
+
+/**
+ * Builds (prefix, index) entries straight from strided records
+ *
+ * When every prefix byte is a copied or sign-flipped record byte (no
+ * float keys) and they all lie within 16 bytes of the record, one
+ * unaligned load, a byte shuffle and an XOR produce the prefix of each
+ * record; AVX2 handles two records per vector and AVX-512 four. Other
+ * layouts, and records whose 16-byte window would run past the data,
+ * go through KeyNormalizer::prefix.
+ */
+class PrefixGather {
+public:
+    PrefixGather(const KeyNormalizer& normalizer, SimdLevel level = detected_simd_level());
+
+    bool vectorized() const { return level_ != SimdLevel::Scalar; }
+
+    /**
+     * Write entries[i - begin] = {prefix of record i, i} for i in [begin, end)
+     * @param record_count Records in data, bounding the window loads
+     */
+    void build(const uint8_t* data, size_t record_length, size_t record_count,
+               size_t begin, size_t end, KeyIndexSort::Entry* entries) const;
+
+private:
+    const KeyNormalizer& normalizer_;
+    SimdLevel level_;
+    simd::GatherPlan plan_;
+};
+
+/**
+ * Add the histogram of bytes[i * stride] ^ mask for i < count to
+ * histogram[256], e.g. one radix digit of strided records
+ */
+void count_bytes(const uint8_t* bytes, size_t stride, size_t count, uint8_t mask, size_t* histogram,
+                 SimdLevel level = detected_simd_level());
+
+/**
+ * Add the histograms of all 8 digits of the native uint64_t at the
+ * start of each item to histograms[8 * 256], least significant first
+ */
+void count_key_bytes(const uint8_t* items, size_t item_size, size_t count, size_t* histograms,
+                     SimdLevel level = detected_simd_level());
+
+/**
+ * Sort entries by (prefix, index) with a vectorized quicksort
+ *
+ * Partitions compare a broadcast pivot entry against two (AVX2) or four
+ * (AVX-512) entries per instruction and write both sides with one
+ * permute and two stores, in the style of the in-place AVX-512
+ * partition of Bramas. Indices must be distinct, which makes every key
+ * distinct and the result the same as any other sort's. The Scalar
+ * level uses std::sort.
+ */
+void sort_entries_by_prefix(KeyIndexSort::Entry* entries, size_t count,
+                            SimdLevel level = detected_simd_level());
+
+} // namespace binsort
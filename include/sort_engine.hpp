@@ -2,12 +2,27 @@
 
 #include "record.hpp"
 #include "comparison_generator.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <memory>
 #include <vector>
 #include <thread>
 
 namespace binsort {
 
+struct SpecializedLayout;
+
+/**
+ * Sorting strategy
+ */
+enum class SortAlgorithm {
+    Auto,       // Pick based on record layout
+    QuickSort,  // Sort records directly (sample sort across threads)
+    KeyIndex,   // Sort (key prefix, index) entries, then permute records once
+    Radix       // LSD radix sort on normalized keys of up to 8 bytes
+};
+
 /**
  * Multi-threaded parallel sorting engine
  */
@@ -17,8 +32,43 @@ public:
         size_t record_length;
         size_t thread_count = std::thread::hardware_concurrency();
         std::vector<KeySpec> keys;
+        SortAlgorithm algorithm = SortAlgorithm::Auto;
+
+        // Keep equal records in input order. Radix and KeyIndex are
+        // stable; QuickSort, whether requested or picked by Auto, is
+        // replaced by KeyIndex.
+        bool stable = false;
+
+        // Pre-scan for existing order: sorted, reversed and nearly sorted
+        // inputs skip the full sort (see AdaptiveSort)
+        bool adaptive = true;
+
+        // Use a compiled-in layout (see specialized_layouts.hpp) when the
+        // keys and record length match one, instead of the JIT
+        bool specialize = true;
+
+        // Scheduler to run on, shared between engines; when null the
+        // engine creates one with thread_count threads
+        std::shared_ptr<ThreadPool> pool;
     };
 
+    /**
+     * Records at least this long use the key-index sort under Auto
+     */
+    static constexpr size_t kKeyIndexMinRecordLength = 64;
+
+    /**
+     * Inputs with at least this many records use radix sort under Auto
+     * when the normalized key fits in 8 bytes
+     */
+    static constexpr size_t kRadixMinRecords = 1 << 14;
+
+    /**
+     * Comparison sorts of at least this many records on more than one
+     * thread use the parallel sample sort
+     */
+    static constexpr size_t kSampleSortMinRecords = 1 << 16;
+
     explicit SortEngine(const Config& config);
     ~SortEngine();
 
@@ -30,58 +80,115 @@ public:
     void sort(uint8_t* data, size_t record_count);
 
     /**
-     * Get the comparison function used by this engine
+     * Sort records from input into output
+     * The input is used as scratch space and left in unspecified order;
+     * map it copy-on-write to keep the source file intact.
+     * @param input Records to sort
+     * @param output Destination for record_count sorted records
+     * @param record_count Number of records to sort
+     */
+    void sort(uint8_t* input, uint8_t* output, size_t record_count);
+
+    /**
+     * Whether records are already in key order, so a copy of the input is
+     * its sorted output; always false when Config::adaptive is off
      */
-    ComparisonFunc get_comparison_func() const { return compare_func_; }
+    bool is_sorted(const uint8_t* data, size_t record_count) const;
 
-private:
-    Config config_;
-    ComparisonFunc compare_func_;
-    bool owns_func_;
+    /**
+     * Get the comparator used by this engine
+     */
+    Comparator get_comparator() const { return compare_; }
 
-    struct Chunk {
-        uint8_t* start;
-        size_t record_count;
-    };
+    /**
+     * Whether comparison sorts use a compiled-in layout
+     */
+    bool specialized() const { return layout_ != nullptr; }
 
     /**
-     * Sort a single chunk in a worker thread
+     * Whether equal records keep their input order
      */
-    void sort_chunk(Chunk chunk);
+    bool stable() const { return config_.stable; }
 
     /**
-     * Merge sorted chunks
+     * Get the scheduler this engine sorts on
      */
-    void merge_chunks(
-        uint8_t* data,
-        const std::vector<Chunk>& chunks
-    );
+    ThreadPool& pool() const { return *pool_; }
 
     /**
-     * Helper to swap two records
+     * Algorithm that sort() will use for this many records (never Auto)
      */
-    void swap_records(uint8_t* a, uint8_t* b) const;
+    SortAlgorithm selected_algorithm(size_t record_count) const;
+
+private:
+    Config config_;
+    Comparator compare_;
+    const SpecializedLayout* layout_ = nullptr;
+    ComparisonFunc jit_func_ = nullptr;
+    std::unique_ptr<InterpretedComparator> interpreter_;
+    std::shared_ptr<ThreadPool> pool_;
+
+    /**
+     * Sort into output, or in place when output is nullptr
+     */
+    void sort_records(uint8_t* data, uint8_t* output, size_t record_count);
 };
 
 /**
  * Quicksort implementation for record data
+ *
+ * Pattern-defeating quicksort (pdqsort) over variable-size records:
+ * median-of-3 / ninther pivots, insertion sort for small ranges, equal-key
+ * partitioning when the pivot repeats, recursion on the smaller side only
+ * and a heapsort fallback, giving O(n log n) worst case and O(log n) stack.
+ *
+ * Given a pool of more than one thread, partitions of at least
+ * kParallelMinRecords records are forked as stealable tasks.
  */
 class RecordQuickSort {
 public:
+    // Smallest partition handed to another thread
+    static constexpr size_t kParallelMinRecords = 1 << 14;
+
     RecordQuickSort(
         size_t record_length,
-        ComparisonFunc compare
+        Comparator compare,
+        ThreadPool* pool = nullptr
     ) : record_length_(record_length)
-      , compare_(compare) {}
+      , compare_(compare)
+      , pool_(pool)
+      , scratch_(record_length) {}
 
     void sort(uint8_t* data, size_t record_count);
 
 private:
-    size_t record_length_;
-    ComparisonFunc compare_;
+    // Ranges below this size are insertion sorted
+    static constexpr size_t kInsertionSortThreshold = 24;
+    // Ranges above this size use the ninther for pivot selection
+    static constexpr size_t kNintherThreshold = 128;
+    // Element moves allowed when optimistically finishing a partition
+    static constexpr size_t kPartialInsertionLimit = 8;
 
-    void quicksort(uint8_t* data, int64_t low, int64_t high);
-    int64_t partition(uint8_t* data, int64_t low, int64_t high);
+    size_t record_length_;
+    Comparator compare_;
+    ThreadPool* pool_;
+    ThreadPool::TaskGroup* group_ = nullptr;
+    uint8_t* data_ = nullptr;
+    std::vector<uint8_t> scratch_;
+
+    uint8_t* at(size_t index) const { return data_ + index * record_length_; }
+    bool less(size_t a, size_t b) const { return compare_(at(a), at(b)) < 0; }
+
+    void sort_loop(size_t begin, size_t end, int bad_allowed, bool leftmost);
+    void sort_side(size_t begin, size_t end, int bad_allowed, bool leftmost);
+    size_t partition_right(size_t begin, size_t end, bool& already_partitioned);
+    size_t partition_left(size_t begin, size_t end);
+    void insertion_sort(size_t begin, size_t end);
+    bool partial_insertion_sort(size_t begin, size_t end);
+    void heap_sort(size_t begin, size_t end);
+    void sift_down(size_t begin, size_t root, size_t count);
+    void sort2(size_t a, size_t b);
+    void sort3(size_t a, size_t b, size_t c);
     void swap_records(uint8_t* a, uint8_t* b);
 };
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "comparison_generator.hpp"
+#include "key_compare.hpp"
+#include "record.hpp"
+#include "sort_engine.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Compile-time record layouts for the key specifications used most
+ *
+ * A RecordLayout fixes the record length and every key's offset, type,
+ * width and order as template parameters, so comparisons inline into the
+ * sort, multi-key compares unroll and records move as fixed-size values
+ * (a few register or vector moves instead of memcpy calls). The layouts
+ * listed in specialized_layouts.cpp are instantiated once; SortEngine
+ * uses one when the requested keys and record length match it exactly,
+ * and the JIT or interpreter otherwise.
+ */
+
+/**
+ * One key at a fixed record offset
+ */
+template <KeyType Type, size_t Offset, size_t Length, SortOrder Order = SortOrder::Ascending>
+struct FieldKey {
+    static_assert(Type == KeyType::Character || Length == 2 || Length == 4 || Length == 8,
+                  "Numeric key length must be 2, 4, or 8 bytes");
+
+    static int compare(const uint8_t* a, const uint8_t* b) {
+        if constexpr (Type == KeyType::Character) {
+            return key_compare::compare_chars<Order>(a + Offset, b + Offset, Length);
+        } else {
+            return key_compare::compare_numeric<Type, Length, Order>(a + Offset, b + Offset);
+        }
+    }
+
+    static bool matches(const KeySpec& key) {
+        return key.position == Offset + 1 && key.length == Length &&
+               key.type == Type && key.order == Order;
+    }
+};
+
+template <size_t Offset, size_t Length, SortOrder Order = SortOrder::Ascending>
+using LittleIntKey = FieldKey<KeyType::LittleEndianInt, Offset, Length, Order>;
+
+template <size_t Offset, size_t Length, SortOrder Order = SortOrder::Ascending>
+using BigIntKey = FieldKey<KeyType::BigEndianInt, Offset, Length, Order>;
+
+/**
+ * Record of a known size, moved and swapped as a value
+ */
+template <size_t Length>
+struct FixedRecord {
+    uint8_t bytes[Length];
+};
+
+/**
+ * Record length and key list; keys compare in list order
+ */
+template <size_t RecordLength, typename... Keys>
+struct RecordLayout {
+    static_assert(sizeof...(Keys) > 0, "A layout needs at least one key");
+
+    using Record = FixedRecord<RecordLength>;
+
+    static int compare(const uint8_t* a, const uint8_t* b) {
+        int cmp = 0;
+        // Stops at the first key that differs
+        (void)(((cmp = Keys::compare(a, b)) != 0) || ...);
+        return cmp;
+    }
+
+    static int compare_function(const uint8_t* a, const uint8_t* b, const void*) {
+        return compare(a, b);
+    }
+
+    static bool matches(const std::vector<KeySpec>& keys, size_t record_length) {
+        if (record_length != RecordLength || keys.size() != sizeof...(Keys)) return false;
+        size_t i = 0;
+        return (Keys::matches(keys[i++]) && ...);
+    }
+
+    static bool less(const Record& a, const Record& b) {
+        return compare(a.bytes, b.bytes) < 0;
+    }
+
+    /**
+     * Sort in place; given a pool of more than one thread, ranges of at
+     * least RecordQuickSort::kParallelMinRecords are forked as tasks
+     */
+    static void sort(uint8_t* data, size_t record_count, ThreadPool* pool) {
+        Record* first = reinterpret_cast<Record*>(data);
+        if (pool == nullptr || pool->size() == 1 || record_count < 2 * RecordQuickSort::kParallelMinRecords) {
+            std::sort(first, first + record_count, less);
+            return;
+        }
+
+        // Unbalanced splits tolerated before std::sort takes the range
+        int depth = 0;
+        for (size_t n = record_count; n > 1; n >>= 1) depth += 2;
+
+        ThreadPool::TaskGroup group(*pool);
+        sort_parallel(first, first + record_count, depth, group);
+        group.wait();
+    }
+
+private:
+    static const Record& median_of_three(const Record& a, const Record& b, const Record& c) {
+        if (less(a, b)) {
+            if (less(b, c)) return b;
+            return less(a, c) ? c : a;
+        }
+        if (less(a, c)) return a;
+        return less(b, c) ? c : b;
+    }
+
+    // Three-way split around a ninther pivot, so runs of equal keys end up
+    // in place instead of in one large side; the smaller side is forked
+    static void sort_parallel(Record* first, Record* last, int depth, ThreadPool::TaskGroup& group) {
+        while (static_cast<size_t>(last - first) >= RecordQuickSort::kParallelMinRecords && depth-- > 0) {
+            const size_t step = static_cast<size_t>(last - first) / 8;
+            const Record pivot = median_of_three(
+                median_of_three(first[step], first[2 * step], first[3 * step]),
+                median_of_three(first[3 * step + 1], first[4 * step], first[5 * step]),
+                median_of_three(first[5 * step + 1], first[6 * step], first[7 * step]));
+
+            Record* middle = std::partition(first, last, [&pivot](const Record& r) { return less(r, pivot); });
+            Record* upper = std::partition(middle, last, [&pivot](const Record& r) { return !less(pivot, r); });
+
+            if (middle - first < last - upper) {
+                group.run([first, middle, depth, &group] { sort_parallel(first, middle, depth, group); });
+                first = upper;
+            } else {
+                group.run([upper, last, depth, &group] { sort_parallel(upper, last, depth, group); });
+                last = middle;
+            }
+        }
+        std::sort(first, last, less);
+    }
+};
+
+/**
+ * A RecordLayout instantiation behind plain function pointers
+ */
+struct SpecializedLayout {
+    bool (*matches)(const std::vector<KeySpec>& keys, size_t record_length);
+
+    // Whole-record compare; ignores the context
+    ComparisonFunc compare;
+
+    // In-place sort, not stable; forks on the pool when given one
+    void (*sort)(uint8_t* data, size_t record_count, ThreadPool* pool);
+};
+
+template <typename Layout>
+constexpr SpecializedLayout specialize() {
+    return {Layout::matches, Layout::compare_function, Layout::sort};
+}
+
+/**
+ * Instantiated layout for these keys and record length, or nullptr
+ */
+const SpecializedLayout* find_specialized_layout(const std::vector<KeySpec>& keys, size_t record_length);
+
+} // namespace binsort
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Persistent work-stealing thread pool with a fork-join API
+ *
+ * Each worker owns a deque: it pushes and pops its own tasks at the back
+ * and steals from the front of other deques when it runs dry. Threads that
+ * are not workers share one extra deque. A thread waiting on a TaskGroup
+ * keeps executing queued tasks until the group completes, so tasks may
+ * fork and wait on nested groups freely.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param thread_count Threads taking part in parallel work, including
+     *        the calling thread; thread_count - 1 workers are started
+     */
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Number of threads taking part in parallel work
+     */
+    size_t size() const { return workers_.size() + 1; }
+
+    /**
+     * Set of forked tasks that can be waited on together
+     */
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+
+        // Waits for outstanding tasks; exceptions are dropped
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        /**
+         * Queue a task on the calling thread's deque
+         */
+        void run(std::function<void()> task);
+
+        /**
+         * Execute queued tasks until every task of this group has finished
+         * @throws the first exception thrown by a task of this group
+         */
+        void wait();
+
+    private:
+        friend class ThreadPool;
+
+        ThreadPool& pool_;
+        std::atomic<size_t> pending_{0};
+        std::mutex error_mutex_;
+        std::exception_ptr error_;
+    };
+
+    /**
+     * Run fn(i) for every i in [0, count) as separate tasks and wait
+     */
+    template <typename Fn>
+    void parallel_for(size_t count, Fn&& fn) {
+        TaskGroup group(*this);
+        for (size_t i = 0; i < count; ++i) {
+            group.run([&fn, i]() { fn(i); });
+        }
+        group.wait();
+    }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        TaskGroup* group;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // queues_[0] is shared by non-worker threads, queues_[i] is worker i's
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    // Tasks sitting in any queue; idle workers sleep while it is zero
+    std::atomic<size_t> queued_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    size_t current_queue() const;
+    void push(Task task);
+    bool try_run(size_t queue);
+    void execute(Task& task);
+    void worker_loop(size_t queue);
+};
+
+} // namespace binsort
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "memory_placement.hpp"
+#include "sort_engine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace binsort {
+
+/**
+ * Selection of the first limit records in key order
+ *
+ * Every pool thread filters its stripe of each input block into a private
+ * buffer of up to 2 * limit candidate records, rejecting any record not
+ * ahead of the buffer's cut-off. When a buffer fills, nth_element over
+ * record pointers keeps its limit best and the worst of those becomes the
+ * new cut-off, so later records mostly cost one comparison each. Over n
+ * records that is O(n) comparisons plus O(limit log limit) to sort the
+ * result, in memory proportional to limit rather than to the input.
+ *
+ * A stable engine gets a single buffer, in which records stay in input
+ * order, and equal records are told apart by their position in it.
+ */
+class TopK {
+public:
+    struct Stats {
+        size_t records = 0;            // Records read from the input
+        size_t selected = 0;           // Records written to the output
+    };
+
+    TopK(size_t record_length, size_t limit, SortEngine& engine);
+
+    /**
+     * Select from input into output; either may be IOFile::kStandardStream.
+     * The input is fully read before the output is opened.
+     * @throws std::runtime_error on I/O failure or misaligned input
+     */
+    Stats select(const std::string& input, const std::string& output);
+
+    /**
+     * Offer count records to the selection
+     */
+    void add(const uint8_t* records, size_t count);
+
+    /**
+     * Records finish() will produce: the limit, or fewer if fewer were added
+     */
+    size_t selected_count() const;
+
+    /**
+     * Write the selected records in sorted order to output, which must
+     * hold selected_count() records, and start a new selection
+     */
+    void finish(uint8_t* output);
+
+private:
+    // Stripes of a block smaller than this are not worth a task
+    static constexpr size_t kMinStripeRecords = 1 << 14;
+
+    /**
+     * Candidate buffer of one stripe
+     */
+    struct Candidates {
+        PlacedVector<uint8_t> records;
+        size_t count = 0;
+        std::vector<uint8_t> cutoff;   // Empty until the first compaction
+        std::vector<const uint8_t*> order;
+    };
+
+    size_t record_length_;
+    size_t limit_;
+    SortEngine& engine_;
+    Comparator compare_;
+    bool stable_;
+    std::vector<Candidates> stripes_;
+    size_t added_ = 0;
+
+    // Key order, then buffer order when stable
+    bool before(const uint8_t* a, const uint8_t* b) const;
+
+    void add_stripe(Candidates& c, const uint8_t* records, size_t count);
+
+    /**
+     * Reduce a buffer to its keep best records and update its cut-off
+     */
+    void compact(Candidates& c, size_t keep);
+};
+
+} // namespace binsort
@@ -0,0 +1,226 @@
+#include "adaptive_sort.hpp"
+#include "loser_tree.hpp"
+#include "memory_placement.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace binsort {
+
+AdaptiveSort::AdaptiveSort(size_t record_length, Comparator compare, bool stable, ThreadPool& pool)
+    : record_length_(record_length)
+    , compare_(compare)
+    , stable_(stable)
+    , pool_(pool) {}
+
+AdaptiveSort::Scan AdaptiveSort::scan(const uint8_t* data, size_t record_count) const {
+    const size_t pairs = record_count - 1;
+    const size_t stripes = std::max<size_t>(1, std::min(pool_.size(), pairs / kMinScanStripe));
+    std::vector<Scan> parts(stripes);
+
+    const auto scan_stripe = [&](size_t s) {
+        Scan& part = parts[s];
+        const size_t begin = pairs * s / stripes;
+        const size_t end = pairs * (s + 1) / stripes;
+        const uint8_t* rec = data + begin * record_length_;
+        for (size_t i = begin; i < end; ++i, rec += record_length_) {
+            const int cmp = compare_(rec, rec + record_length_);
+            if (cmp > 0) {
+                if (part.breaks.size() < kMaxNaturalRuns - 1) {
+                    part.breaks.push_back(i + 1);
+                } else {
+                    part.many_breaks = true;
+                }
+            } else if (cmp < 0) {
+                part.rising = true;
+            } else {
+                part.ties = true;
+            }
+            // Neither sorted, descending nor a few runs
+            if (part.many_breaks && part.rising) return;
+        }
+    };
+    if (stripes == 1) {
+        scan_stripe(0);
+    } else {
+        pool_.parallel_for(stripes, scan_stripe);
+    }
+
+    Scan total;
+    for (const Scan& part : parts) {
+        total.breaks.insert(total.breaks.end(), part.breaks.begin(), part.breaks.end());
+        total.many_breaks |= part.many_breaks;
+        total.rising |= part.rising;
+        total.ties |= part.ties;
+    }
+    if (total.breaks.size() > kMaxNaturalRuns - 1) {
+        total.many_breaks = true;
+    }
+    return total;
+}
+
+bool AdaptiveSort::is_sorted(const uint8_t* data, size_t record_count) const {
+    if (record_count < 2) return true;
+
+    const size_t pairs = record_count - 1;
+    const size_t stripes = std::max<size_t>(1, std::min(pool_.size(), pairs / kMinScanStripe));
+    std::atomic<bool> descent{false};
+
+    const auto scan_stripe = [&](size_t s) {
+        const size_t begin = pairs * s / stripes;
+        const size_t end = pairs * (s + 1) / stripes;
+        const uint8_t* rec = data + begin * record_length_;
+        for (size_t i = begin; i < end; ++i, rec += record_length_) {
+            if (compare_(rec, rec + record_length_) > 0) {
+                descent.store(true, std::memory_order_relaxed);
+                return;
+            }
+            // Poll the other stripes once per block
+            if (i % kMinScanStripe == 0 && descent.load(std::memory_order_relaxed)) return;
+        }
+    };
+    if (stripes == 1) {
+        scan_stripe(0);
+    } else {
+        pool_.parallel_for(stripes, scan_stripe);
+    }
+    return !descent.load(std::memory_order_relaxed);
+}
+
+bool AdaptiveSort::sort(uint8_t* data, uint8_t* output, size_t record_count, const SortFunction& sort_tail) {
+    if (record_count < 2) return false;
+
+    const Scan order = scan(data, record_count);
+
+    if (order.breaks.empty()) {
+        if (output != nullptr) {
+            std::memcpy(output, data, record_count * record_length_);
+        }
+        return true;
+    }
+
+    if (!order.rising && !(stable_ && order.ties)) {
+        reverse(data, output, record_count);
+        return true;
+    }
+
+    const size_t prefix = order.breaks.front();
+    if (record_count - prefix <= record_count / kTailFraction) {
+        sort_tail(at(data, prefix), record_count - prefix);
+        merge_tail(data, output, record_count, prefix);
+        return true;
+    }
+
+    if (!order.many_breaks) {
+        if (output != nullptr) {
+            merge_runs(data, output, record_count, order.breaks);
+        } else {
+            PlacedVector<uint8_t> merged(record_count * record_length_);
+            merge_runs(data, merged.data(), record_count, order.breaks);
+            std::memcpy(data, merged.data(), merged.size());
+        }
+        return true;
+    }
+    return false;
+}
+
+void AdaptiveSort::reverse(uint8_t* data, uint8_t* output, size_t record_count) const {
+    const size_t length = record_length_;
+    // In place, each task swaps records i and count - 1 - i for its share
+    // of the first half
+    const size_t work = (output != nullptr) ? record_count : record_count / 2;
+    const size_t tasks = std::max<size_t>(1, std::min(pool_.size(), work / kMinScanStripe));
+
+    pool_.parallel_for(tasks, [&](size_t t) {
+        const size_t begin = work * t / tasks;
+        const size_t end = work * (t + 1) / tasks;
+        if (output != nullptr) {
+            for (size_t i = begin; i < end; ++i) {
+                std::memcpy(at(output, i), at(data, record_count - 1 - i), length);
+            }
+            return;
+        }
+        std::vector<uint8_t> temp(length);
+        for (size_t i = begin; i < end; ++i) {
+            uint8_t* a = at(data, i);
+            uint8_t* b = at(data, record_count - 1 - i);
+            std::memcpy(temp.data(), a, length);
+            std::memcpy(a, b, length);
+            std::memcpy(b, temp.data(), length);
+        }
+    });
+}
+
+void AdaptiveSort::merge_tail(uint8_t* data, uint8_t* output, size_t record_count, size_t prefix) const {
+    const size_t length = record_length_;
+    const size_t tail = record_count - prefix;
+
+    if (output != nullptr) {
+        const uint8_t* left = data;
+        const uint8_t* left_end = at(data, prefix);
+        const uint8_t* right = left_end;
+        const uint8_t* right_end = at(data, record_count);
+        uint8_t* out = output;
+        while (left < left_end && right < right_end) {
+            // Ties go to the prefix, which came first
+            if (compare_(right, left) < 0) {
+                std::memcpy(out, right, length);
+                right += length;
+            } else {
+                std::memcpy(out, left, length);
+                left += length;
+            }
+            out += length;
+        }
+        std::memcpy(out, left, left_end - left);
+        out += left_end - left;
+        std::memcpy(out, right, right_end - right);
+        return;
+    }
+
+    // Appended records that all sort after the prefix need no merge
+    if (compare_(at(data, prefix - 1), at(data, prefix)) <= 0) return;
+
+    // Merge from the back with the tail moved aside: prefix records are
+    // only moved if they belong after some tail record
+    PlacedVector<uint8_t> moved(data + prefix * length, data + record_count * length);
+    size_t i = prefix;
+    size_t j = tail;
+    for (size_t k = record_count; j > 0; --k) {
+        const uint8_t* right = moved.data() + (j - 1) * length;
+        if (i > 0 && compare_(at(data, i - 1), right) > 0) {
+            std::memcpy(at(data, k - 1), at(data, i - 1), length);
+            --i;
+        } else {
+            std::memcpy(at(data, k - 1), right, length);
+            --j;
+        }
+    }
+}
+
+void AdaptiveSort::merge_runs(const uint8_t* data, uint8_t* output, size_t record_count,
+                              const std::vector<size_t>& breaks) const {
+    const size_t runs = breaks.size() + 1;
+    std::vector<size_t> next(runs);
+    std::vector<size_t> end(runs);
+    std::vector<const uint8_t*> heads(runs);
+    for (size_t r = 0; r < runs; ++r) {
+        next[r] = (r == 0) ? 0 : breaks[r - 1];
+        end[r] = (r < breaks.size()) ? breaks[r] : record_count;
+        heads[r] = data + next[r] * record_length_;
+    }
+
+    // Runs are sources in input order, so ties keep input order
+    LoserTree tree(runs, compare_);
+    tree.reset(heads);
+    uint8_t* out = output;
+    while (!tree.empty()) {
+        const size_t r = tree.winner();
+        std::memcpy(out, tree.winner_record(), record_length_);
+        out += record_length_;
+        ++next[r];
+        tree.replace_winner(next[r] < end[r] ? data + next[r] * record_length_ : nullptr);
+    }
+}
+
+} // namespace binsort
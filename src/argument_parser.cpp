@@ -2,6 +2,7 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <cctype>
 #include <thread>
 
 namespace binsort {
@@ -12,18 +13,23 @@ ArgumentParser::Arguments ArgumentParser::parse(int argc, char* argv[]) {
     }
     
     Arguments args;
-    args.input_file = argv[1];
-    args.output_file = argv[2];
     
     // Default thread count
     args.thread_count = std::thread::hardware_concurrency();
     if (args.thread_count == 0) args.thread_count = 1;
     
-    // Find the "/" separator
+    // Find the "/" separator; the files before it are the inputs and then
+    // the output
     bool found_separator = false;
-    for (int i = 3; i < argc; ++i) {
+    for (int i = 1; i < argc; ++i) {
         if (std::string(argv[i]) == "/") {
             found_separator = true;
+            if (i < 3) {
+                throw std::runtime_error("Missing input or output file");
+            }
+            args.input_files.assign(argv + 1, argv + i - 1);
+            args.input_file = args.input_files.front();
+            args.output_file = argv[i - 1];
             
             // Parse parameters after "/"
             for (int j = i + 1; j < argc; ++j) {
@@ -42,6 +48,62 @@ ArgumentParser::Arguments ArgumentParser::parse(int argc, char* argv[]) {
                     args.thread_count = std::stoull(*value);
                     if (args.thread_count == 0) args.thread_count = 1;
                 }
+                // Check for algorithm(...)
+                else if (auto value = extract_param(arg, "algorithm")) {
+                    args.algorithm = parse_algorithm(*value);
+                }
+                // Check for memory(...)
+                else if (auto value = extract_param(arg, "memory")) {
+                    args.memory_budget = parse_size(*value);
+                    if (args.memory_budget == 0) {
+                        throw std::runtime_error("Memory budget must be positive");
+                    }
+                }
+                // Check for temp(...)
+                else if (auto value = extract_param(arg, "temp")) {
+                    args.temp_directory = *value;
+                }
+                // Check for io(...)
+                else if (auto value = extract_param(arg, "io")) {
+                    if (*value == "direct") args.direct_io = true;
+                    else if (*value == "buffered") args.direct_io = false;
+                    else throw std::runtime_error("Unknown I/O mode: " + *value);
+                }
+                // Check for huge_pages(...)
+                else if (auto value = extract_param(arg, "huge_pages")) {
+                    if (*value == "explicit") args.explicit_huge_pages = true;
+                    else if (*value == "transparent") args.explicit_huge_pages = false;
+                    else throw std::runtime_error("Unknown huge page mode: " + *value);
+                }
+                // Check for limit(...)
+                else if (auto value = extract_param(arg, "limit")) {
+                    args.limit = std::stoull(*value);
+                    if (args.limit == 0) {
+                        throw std::runtime_error("Limit must be positive");
+                    }
+                }
+                // Check for stable(...)
+                else if (auto value = extract_param(arg, "stable")) {
+                    if (*value == "yes") args.stable = true;
+                    else if (*value == "no") args.stable = false;
+                    else throw std::runtime_error("Unknown stable setting: " + *value);
+                }
+                // Check for unique(...)
+                else if (auto value = extract_param(arg, "unique")) {
+                    if (*value == "first") args.groups.duplicates = DuplicateMode::KeepFirst;
+                    else if (*value == "last") args.groups.duplicates = DuplicateMode::KeepLast;
+                    else throw std::runtime_error("Unknown unique mode: " + *value);
+                }
+                // Check for count(...)
+                else if (auto value = extract_param(arg, "count")) {
+                    parse_count_spec(*value, args.groups);
+                }
+                // Check for merge(...)
+                else if (auto value = extract_param(arg, "merge")) {
+                    if (*value == "yes") args.merge = true;
+                    else if (*value == "no") args.merge = false;
+                    else throw std::runtime_error("Unknown merge setting: " + *value);
+                }
                 else {
                     throw std::runtime_error("Unknown parameter: " + arg);
                 }
@@ -85,9 +147,66 @@ ArgumentParser::Arguments ArgumentParser::parse(int argc, char* argv[]) {
         }
     }
     
+    // The count field is written into kept records, so it must not change
+    // their keys
+    if (args.groups.count_length > 0) {
+        const size_t begin = args.groups.count_offset;
+        const size_t end = begin + args.groups.count_length;
+        if (end > args.record_length) {
+            throw std::runtime_error("Count field extends beyond record length");
+        }
+        for (const auto& key : args.keys) {
+            if (begin < key.offset() + key.length && key.offset() < end) {
+                throw std::runtime_error("Count field overlaps a sort key");
+            }
+        }
+    }
+    if (args.limit > 0 && args.groups.active()) {
+        throw std::runtime_error("limit() cannot be combined with unique() or count()");
+    }
+    if (args.input_files.size() > 1 && !args.merge) {
+        throw std::runtime_error("Several input files need merge(yes)");
+    }
+    if (args.merge && args.limit > 0) {
+        throw std::runtime_error("limit() cannot be combined with merge(yes)");
+    }
+    // Top-K reads its input through the page cache and holds only the
+    // selected records, so these options would have no effect
+    if (args.limit > 0 && (args.direct_io || args.memory_budget > 0)) {
+        throw std::runtime_error("limit() cannot be combined with io(direct) or memory()");
+    }
+    
     return args;
 }
 
+void ArgumentParser::parse_count_spec(const std::string& spec, GroupReducer::Config& groups) {
+    std::istringstream ss(spec);
+    std::string token;
+    std::vector<std::string> tokens;
+    while (std::getline(ss, token, ',')) {
+        tokens.push_back(token);
+    }
+    if (tokens.size() != 2 && tokens.size() != 3) {
+        throw std::runtime_error("Count field must be pos,len[,type]");
+    }
+
+    const size_t position = std::stoull(tokens[0]);
+    if (position == 0) {
+        throw std::runtime_error("Count position must be >= 1 (1-based)");
+    }
+    groups.count_offset = position - 1;
+    groups.count_length = std::stoull(tokens[1]);
+    if (groups.count_length != 2 && groups.count_length != 4 && groups.count_length != 8) {
+        throw std::runtime_error("Count length must be 2, 4, or 8 bytes");
+    }
+
+    groups.count_big_endian = false;
+    if (tokens.size() == 3) {
+        if (tokens[2] == "W") groups.count_big_endian = true;
+        else if (tokens[2] != "w") throw std::runtime_error("Count type must be w or W");
+    }
+}
+
 std::vector<KeySpec> ArgumentParser::parse_sort_spec(const std::string& spec) {
     std::vector<KeySpec> keys;
     std::istringstream ss(spec);
@@ -159,6 +278,39 @@ SortOrder ArgumentParser::parse_sort_order(char c) {
     }
 }
 
+SortAlgorithm ArgumentParser::parse_algorithm(const std::string& name) {
+    if (name == "auto") return SortAlgorithm::Auto;
+    if (name == "quicksort") return SortAlgorithm::QuickSort;
+    if (name == "index") return SortAlgorithm::KeyIndex;
+    if (name == "radix") return SortAlgorithm::Radix;
+    throw std::runtime_error("Unknown algorithm: " + name);
+}
+
+size_t ArgumentParser::parse_size(const std::string& value) {
+    size_t digits = 0;
+    while (digits < value.size() && std::isdigit(static_cast<unsigned char>(value[digits]))) {
+        ++digits;
+    }
+    if (digits == 0 || value.size() - digits > 1) {
+        throw std::runtime_error("Invalid size: " + value);
+    }
+
+    size_t size = std::stoull(value.substr(0, digits));
+    if (digits < value.size()) {
+        unsigned shift = 0;
+        switch (std::toupper(static_cast<unsigned char>(value.back()))) {
+            case 'K': shift = 10; break;
+            case 'M': shift = 20; break;
+            case 'G': shift = 30; break;
+            case 'T': shift = 40; break;
+            default:
+                throw std::runtime_error("Invalid size suffix: " + value);
+        }
+        size <<= shift;
+    }
+    return size;
+}
+
 std::optional<std::string> ArgumentParser::extract_param(
     const std::string& arg,
     const std::string& param_name
@@ -175,7 +327,9 @@ std::optional<std::string> ArgumentParser::extract_param(
 
 void ArgumentParser::print_usage(const char* program_name) {
     std::cout << "Usage: " << program_name 
-              << " <input_file> <output_file> / <parameters>\n\n"
+              << " <input_file>... <output_file> / <parameters>\n"
+              << "  Either file may be - (stdin/stdout) or a pipe; several\n"
+              << "  inputs need merge(yes)\n\n"
               << "Parameters:\n"
               << "  sort(pos,len,type,order[,...])\n"
               << "    pos:   1-based position in record\n"
@@ -186,6 +340,38 @@ void ArgumentParser::print_usage(const char* program_name) {
               << "    Record length in bytes\n\n"
               << "  thread_count(N)\n"
               << "    Number of threads (default: CPU cores)\n\n"
+              << "  algorithm(auto|quicksort|index|radix)\n"
+              << "    quicksort: move records directly; sample sort across threads\n"
+              << "    index:     sort key prefixes + record indices, then permute\n"
+              << "    radix:     LSD radix sort, keys totalling <= 8 bytes\n"
+              << "    auto:      radix when keys fit, else index for records\n"
+              << "               >= 64 bytes, else quicksort (default)\n\n"
+              << "  memory(SIZE)\n"
+              << "    Memory budget, e.g. 512M or 8G; larger inputs are sorted\n"
+              << "    externally through runs spilled to disk (default: no limit)\n\n"
+              << "  temp(DIR)\n"
+              << "    Directory for spilled runs (default: output file's directory)\n\n"
+              << "  io(buffered|direct)\n"
+              << "    direct: bypass the page cache with O_DIRECT; memory use is\n"
+              << "    bounded by the sort's own buffers (default: buffered)\n\n"
+              << "  huge_pages(transparent|explicit)\n"
+              << "    explicit: take large buffers from the reserved hugetlbfs\n"
+              << "    pool first (default: transparent)\n\n"
+              << "  limit(N)\n"
+              << "    Write only the first N records in key order; memory use\n"
+              << "    grows with N, not with the input (default: all records)\n\n"
+              << "  stable(yes|no)\n"
+              << "    yes: equal records keep their input order; quicksort is\n"
+              << "    replaced by the index sort (default: no)\n\n"
+              << "  unique(first|last)\n"
+              << "    Keep one record per key, the first or last in input order\n\n"
+              << "  count(pos,len[,w|W])\n"
+              << "    Keep one record per key (the first unless unique(last)) and\n"
+              << "    store the number of records with that key in an unsigned\n"
+              << "    2, 4 or 8 byte field, little-endian (w) or big-endian (W)\n\n"
+              << "  merge(yes|no)\n"
+              << "    yes: the input files are each sorted already; merge them in\n"
+              << "    one sequential pass, failing on out-of-order input\n\n"
               << "Example:\n"
               << "  " << program_name 
               << " input.dat output.dat / sort(1,4,w,a,5,4,w,d) record(16) thread_count(4)\n";
@@ -0,0 +1,192 @@
+#include "async_io.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace binsort {
+
+size_t IOFile::read_at(void* buffer, size_t size, uint64_t offset) {
+    const size_t done = transfer_at(handle_, false, static_cast<uint8_t*>(buffer), padded(size), size, offset);
+    return std::min(done, size);
+}
+
+void IOFile::write_at(const void* buffer, size_t size, uint64_t offset) {
+    const size_t length = padded(size);
+    transfer_at(handle_, true, const_cast<uint8_t*>(static_cast<const uint8_t*>(buffer)), length, length, offset);
+    note_write(offset + size);
+}
+
+namespace {
+
+/**
+ * Portable backend: I/O threads issuing blocking positional calls
+ */
+class ThreadedIO : public AsyncIO {
+public:
+    explicit ThreadedIO(size_t threads) {
+        for (size_t i = 0; i < std::max<size_t>(1, threads); ++i) {
+            workers_.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ThreadedIO() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_ready_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    Backend backend() const override { return Backend::Threads; }
+
+protected:
+    void submit(const Request& request) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requests_.push_back(request);
+        }
+        work_ready_.notify_one();
+    }
+
+    Completion reap() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_ready_.wait(lock, [this]() { return !done_.empty(); });
+        Completion completion = std::move(done_.front());
+        done_.pop_front();
+        return completion;
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable done_ready_;
+    std::deque<Request> requests_;
+    std::deque<Completion> done_;
+    bool stopping_ = false;
+
+    void run() {
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_ready_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+                if (requests_.empty()) return;
+                request = requests_.front();
+                requests_.pop_front();
+            }
+
+            Completion completion{request.tag, request.required, 0, nullptr};
+            try {
+                completion.bytes = IOFile::transfer_at(request.handle, request.write, request.buffer,
+                                                      request.size, request.required, request.offset);
+            } catch (...) {
+                completion.error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                done_.push_back(std::move(completion));
+            }
+            done_ready_.notify_one();
+        }
+    }
+};
+
+} // namespace
+
+std::unique_ptr<AsyncIO> AsyncIO::create(size_t queue_depth) {
+    if (auto uring = create_uring(queue_depth)) {
+        return uring;
+    }
+    return create(Backend::Threads, queue_depth);
+}
+
+std::unique_ptr<AsyncIO> AsyncIO::create(Backend backend, size_t queue_depth) {
+    if (backend == Backend::IoUring) {
+        return create_uring(queue_depth);
+    }
+    // Blocking calls gain little beyond a handful of threads
+    return std::make_unique<ThreadedIO>(std::min<size_t>(queue_depth, 8));
+}
+
+uint64_t AsyncIO::read(IOFile& file, void* buffer, size_t size, uint64_t offset) {
+    return queue(false, file, static_cast<uint8_t*>(buffer), size, offset);
+}
+
+uint64_t AsyncIO::write(IOFile& file, const void* buffer, size_t size, uint64_t offset) {
+    // Requests never write through a read buffer; the cast only shares
+    // the request layout
+    return queue(true, file, const_cast<uint8_t*>(static_cast<const uint8_t*>(buffer)), size, offset);
+}
+
+uint64_t AsyncIO::queue(bool write, IOFile& file, uint8_t* buffer, size_t size, uint64_t offset) {
+    const uint64_t id = next_transfer_++;
+    const size_t chunks = std::max<size_t>(1, (size + kChunkBytes - 1) / kChunkBytes);
+    transfers_[id] = Transfer{chunks, false, nullptr};
+
+    for (size_t done = 0, c = 0; c < chunks; ++c) {
+        const size_t length = std::min(kChunkBytes, size - done);
+        const size_t padded = file.padded(length);
+        submit({write, file.native_handle(), buffer + done, padded, write ? padded : length, offset + done, id});
+        done += length;
+    }
+    if (write) {
+        file.note_write(offset + size);
+    }
+    return id;
+}
+
+void AsyncIO::complete_one() {
+    Completion completion = reap();
+    auto it = transfers_.find(completion.tag);
+    if (it == transfers_.end()) return;
+
+    Transfer& transfer = it->second;
+    if (completion.error && !transfer.error) {
+        transfer.error = completion.error;
+    }
+    if (completion.bytes < completion.required) {
+        transfer.short_read = true;
+    }
+    transfer.pending--;
+}
+
+void AsyncIO::wait(uint64_t id) {
+    auto it = transfers_.find(id);
+    if (it == transfers_.end()) return;
+
+    while (it->second.pending > 0) {
+        complete_one();
+    }
+
+    const Transfer transfer = it->second;
+    transfers_.erase(it);
+    if (transfer.error) {
+        std::rethrow_exception(transfer.error);
+    }
+    if (transfer.short_read) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+}
+
+void AsyncIO::wait_all() {
+    std::exception_ptr first;
+    while (!transfers_.empty()) {
+        try {
+            wait(transfers_.begin()->first);
+        } catch (...) {
+            if (!first) first = std::current_exception();
+        }
+    }
+    if (first) std::rethrow_exception(first);
+}
+
+} // namespace binsort
@@ -0,0 +1,363 @@
+#include "async_io.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define BINSORT_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <deque>
+#include <vector>
+#endif
+
+namespace binsort {
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string& what, int error) {
+    throw std::runtime_error(what + " - " + std::strerror(error));
+}
+
+// Pipes, sockets and terminals have no file position to address
+bool is_seekable(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 && (S_ISREG(st.st_mode) || S_ISBLK(st.st_mode));
+}
+
+} // namespace
+
+IOFile::IOFile(const std::string& path, Mode mode, bool direct)
+    : path_(path)
+    , mode_(mode) {
+    if (path == kStandardStream) {
+        // A duplicate, so closing it leaves the process's stream open
+        const int fd = dup((mode == Mode::Read) ? STDIN_FILENO : STDOUT_FILENO);
+        if (fd == -1) {
+            throw_errno("Failed to open standard stream", errno);
+        }
+        handle_ = fd;
+        seekable_ = is_seekable(fd);
+        return;
+    }
+
+    const int flags = ((mode == Mode::Read) ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC)) | O_CLOEXEC;
+    int fd = -1;
+#ifdef O_DIRECT
+    if (direct) {
+        fd = open(path.c_str(), flags | O_DIRECT, 0644);
+        // EINVAL: the filesystem does not support O_DIRECT (tmpfs, some FUSE)
+        if (fd == -1 && errno != EINVAL) {
+            throw_errno("Failed to open file: " + path, errno);
+        }
+        direct_ = fd != -1;
+    }
+#endif
+    if (fd == -1) {
+        fd = open(path.c_str(), flags, 0644);
+    }
+    if (fd == -1) {
+        throw_errno("Failed to open file: " + path, errno);
+    }
+#ifdef __APPLE__
+    // No O_DIRECT; F_NOCACHE keeps transfers out of the cache without
+    // alignment rules, which the padding still satisfies
+    if (direct && fcntl(fd, F_NOCACHE, 1) == 0) {
+        direct_ = true;
+    }
+#endif
+    handle_ = fd;
+    seekable_ = is_seekable(fd);
+}
+
+IOFile::~IOFile() {
+    trim();
+    close(static_cast<int>(handle_));
+}
+
+uint64_t IOFile::size() const {
+    struct stat st;
+    if (fstat(static_cast<int>(handle_), &st) != 0) {
+        throw_errno("Cannot stat file: " + path_, errno);
+    }
+    return static_cast<uint64_t>(st.st_size);
+}
+
+void IOFile::trim() {
+    if (direct_ && mode_ == Mode::Write && written_end_ % kDirectAlignment != 0) {
+        // Nothing to report to from a destructor; a failure leaves at
+        // most one block of padding behind
+        (void)ftruncate(static_cast<int>(handle_), static_cast<off_t>(written_end_));
+    }
+}
+
+size_t IOFile::read_next(void* buffer, size_t size) {
+    const int fd = static_cast<int>(handle_);
+    uint8_t* bytes = static_cast<uint8_t*>(buffer);
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = read(fd, bytes + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("Error reading " + path_, errno);
+        }
+        if (n == 0) break;  // End of stream
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+void IOFile::write_next(const void* buffer, size_t size) {
+    const int fd = static_cast<int>(handle_);
+    const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = write(fd, bytes + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("Error writing " + path_, errno);
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+size_t IOFile::transfer_at(intptr_t handle, bool write, uint8_t* buffer,
+                           size_t size, size_t required, uint64_t offset) {
+    const int fd = static_cast<int>(handle);
+    size_t done = 0;
+    while (done < (write ? size : required)) {
+        const ssize_t n = write
+            ? pwrite(fd, buffer + done, size - done, static_cast<off_t>(offset + done))
+            : pread(fd, buffer + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw_errno(write ? "Error writing file" : "Error reading file", errno);
+        }
+        if (n == 0) {
+            if (write) throw std::runtime_error("Error writing file - no progress");
+            break;  // End of file
+        }
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+#ifdef BINSORT_HAVE_IO_URING
+
+namespace {
+
+/**
+ * io_uring driven through the raw system calls
+ *
+ * Every request occupies a slot until it has fully completed; short
+ * transfers are resubmitted for the remainder from the same slot. The
+ * submission queue has one entry per slot and the completion queue twice
+ * that, so neither can overflow.
+ */
+class UringIO : public AsyncIO {
+public:
+    static std::unique_ptr<AsyncIO> create(size_t queue_depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        const int fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(queue_depth), &params));
+        if (fd < 0) return nullptr;
+
+        // IORING_OP_READ/WRITE arrived together with RW_CUR_POS (5.6)
+        const uint32_t required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_RW_CUR_POS;
+        if ((params.features & required) != required) {
+            close(fd);
+            return nullptr;
+        }
+        return std::unique_ptr<AsyncIO>(new UringIO(fd, params));
+    }
+
+    ~UringIO() override {
+        // The kernel may still write into request buffers until they finish
+        try {
+            while (in_flight_ > 0) reap_one();
+        } catch (...) {
+        }
+        munmap(sqes_, sqes_bytes_);
+        munmap(ring_, ring_bytes_);
+        close(fd_);
+    }
+
+    Backend backend() const override { return Backend::IoUring; }
+
+protected:
+    void submit(const Request& request) override {
+        while (free_slots_.empty()) {
+            reap_one();
+        }
+        const uint32_t slot = free_slots_.back();
+        free_slots_.pop_back();
+        slots_[slot] = Slot{request, 0};
+        in_flight_++;
+        push(slot);
+    }
+
+    Completion reap() override {
+        while (ready_.empty()) {
+            reap_one();
+        }
+        Completion completion = std::move(ready_.front());
+        ready_.pop_front();
+        return completion;
+    }
+
+private:
+    struct Slot {
+        Request request;
+        size_t done;
+    };
+
+    int fd_;
+    void* ring_;
+    size_t ring_bytes_;
+    io_uring_sqe* sqes_;
+    size_t sqes_bytes_;
+
+    uint32_t* sq_tail_;
+    uint32_t sq_mask_;
+    uint32_t* sq_array_;
+    uint32_t* cq_head_;
+    uint32_t* cq_tail_;
+    uint32_t cq_mask_;
+    io_uring_cqe* cqes_;
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    size_t in_flight_ = 0;
+    std::deque<Completion> ready_;
+
+    UringIO(int fd, const io_uring_params& params)
+        : fd_(fd) {
+        const size_t sq_bytes = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        const size_t cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring_bytes_ = std::max(sq_bytes, cq_bytes);
+        ring_ = mmap(nullptr, ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+        if (ring_ == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            throw_errno("Cannot map io_uring", error);
+        }
+
+        sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            const int error = errno;
+            munmap(ring_, ring_bytes_);
+            close(fd);
+            throw_errno("Cannot map io_uring", error);
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        uint8_t* ring = static_cast<uint8_t*>(ring_);
+        sq_tail_ = reinterpret_cast<uint32_t*>(ring + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<uint32_t*>(ring + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<uint32_t*>(ring + params.sq_off.array);
+        cq_head_ = reinterpret_cast<uint32_t*>(ring + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<uint32_t*>(ring + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<uint32_t*>(ring + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+        slots_.resize(params.sq_entries);
+        for (uint32_t i = params.sq_entries; i > 0; --i) {
+            free_slots_.push_back(i - 1);
+        }
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        while (true) {
+            const long result = syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0);
+            if (result >= 0) return static_cast<int>(result);
+            if (errno != EINTR) throw_errno("io_uring_enter failed", errno);
+        }
+    }
+
+    // Queue the remainder of a slot's request and submit it
+    void push(uint32_t slot) {
+        const Slot& s = slots_[slot];
+        const uint32_t tail = *sq_tail_;
+        const uint32_t index = tail & sq_mask_;
+
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = s.request.write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe.fd = static_cast<int>(s.request.handle);
+        sqe.addr = reinterpret_cast<uint64_t>(s.request.buffer + s.done);
+        sqe.len = static_cast<uint32_t>(s.request.size - s.done);
+        sqe.off = s.request.offset + s.done;
+        sqe.user_data = slot;
+
+        sq_array_[index] = index;
+        std::atomic_ref<uint32_t>(*sq_tail_).store(tail + 1, std::memory_order_release);
+        enter(1, 0, 0);
+    }
+
+    // Wait for one completion queue entry and account for it
+    void reap_one() {
+        uint32_t head = *cq_head_;
+        while (head == std::atomic_ref<uint32_t>(*cq_tail_).load(std::memory_order_acquire)) {
+            enter(0, 1, IORING_ENTER_GETEVENTS);
+        }
+        const io_uring_cqe cqe = cqes_[head & cq_mask_];
+        std::atomic_ref<uint32_t>(*cq_head_).store(head + 1, std::memory_order_release);
+
+        const uint32_t slot = static_cast<uint32_t>(cqe.user_data);
+        Slot& s = slots_[slot];
+
+        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+            push(slot);
+            return;
+        }
+        if (cqe.res > 0) {
+            s.done += static_cast<size_t>(cqe.res);
+            if (s.done < s.request.required) {
+                push(slot);
+                return;
+            }
+        }
+
+        Completion completion{s.request.tag, s.request.required, s.done, nullptr};
+        if (cqe.res < 0) {
+            const char* what = s.request.write ? "Error writing file" : "Error reading file";
+            completion.error = std::make_exception_ptr(
+                std::runtime_error(std::string(what) + " - " + std::strerror(-cqe.res)));
+        } else if (cqe.res == 0 && s.request.write) {
+            completion.error = std::make_exception_ptr(
+                std::runtime_error("Error writing file - no progress"));
+        }
+        ready_.push_back(std::move(completion));
+        free_slots_.push_back(slot);
+        in_flight_--;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<AsyncIO> AsyncIO::create_uring(size_t queue_depth) {
+    return UringIO::create(queue_depth);
+}
+
+#else
+
+std::unique_ptr<AsyncIO> AsyncIO::create_uring(size_t) {
+    return nullptr;
+}
+
+#endif
+
+} // namespace binsort
+
+#endif // !_WIN32
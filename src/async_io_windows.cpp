@@ -0,0 +1,136 @@
+#include "async_io.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+namespace binsort {
+
+IOFile::IOFile(const std::string& path, Mode mode, bool direct)
+    : path_(path)
+    , mode_(mode)
+    , direct_(direct) {
+    if (path == kStandardStream) {
+        // A duplicate, so closing it leaves the process's stream open
+        HANDLE process = GetCurrentProcess();
+        HANDLE stream = GetStdHandle((mode == Mode::Read) ? STD_INPUT_HANDLE : STD_OUTPUT_HANDLE);
+        HANDLE handle = nullptr;
+        if (!DuplicateHandle(process, stream, process, &handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+            throw std::runtime_error("Failed to open standard stream");
+        }
+        handle_ = reinterpret_cast<intptr_t>(handle);
+        direct_ = false;
+        seekable_ = GetFileType(handle) == FILE_TYPE_DISK;
+        return;
+    }
+
+    HANDLE handle = CreateFileA(
+        path.c_str(),
+        (mode == Mode::Read) ? GENERIC_READ : GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr,
+        (mode == Mode::Read) ? OPEN_EXISTING : CREATE_ALWAYS,
+        direct ? (FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING) : FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    handle_ = reinterpret_cast<intptr_t>(handle);
+    seekable_ = GetFileType(handle) == FILE_TYPE_DISK;
+}
+
+IOFile::~IOFile() {
+    trim();
+    CloseHandle(reinterpret_cast<HANDLE>(handle_));
+}
+
+uint64_t IOFile::size() const {
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(reinterpret_cast<HANDLE>(handle_), &size)) {
+        throw std::runtime_error("Cannot get file size: " + path_);
+    }
+    return static_cast<uint64_t>(size.QuadPart);
+}
+
+void IOFile::trim() {
+    if (direct_ && mode_ == Mode::Write && written_end_ % kDirectAlignment != 0) {
+        // Setting the end of file needs no alignment, even unbuffered
+        FILE_END_OF_FILE_INFO info;
+        info.EndOfFile.QuadPart = static_cast<LONGLONG>(written_end_);
+        SetFileInformationByHandle(reinterpret_cast<HANDLE>(handle_), FileEndOfFileInfo, &info, sizeof(info));
+    }
+}
+
+size_t IOFile::read_next(void* buffer, size_t size) {
+    HANDLE file = reinterpret_cast<HANDLE>(handle_);
+    uint8_t* bytes = static_cast<uint8_t*>(buffer);
+    size_t done = 0;
+    while (done < size) {
+        const DWORD length = static_cast<DWORD>(std::min<size_t>(size - done, 1u << 30));
+        DWORD moved = 0;
+        if (!ReadFile(file, bytes + done, length, &moved, nullptr)) {
+            // The writer closing a pipe is its end of file
+            if (GetLastError() == ERROR_BROKEN_PIPE || GetLastError() == ERROR_HANDLE_EOF) break;
+            throw std::runtime_error("Error reading " + path_);
+        }
+        if (moved == 0) break;  // End of stream
+        done += moved;
+    }
+    return done;
+}
+
+void IOFile::write_next(const void* buffer, size_t size) {
+    HANDLE file = reinterpret_cast<HANDLE>(handle_);
+    const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+    size_t done = 0;
+    while (done < size) {
+        const DWORD length = static_cast<DWORD>(std::min<size_t>(size - done, 1u << 30));
+        DWORD moved = 0;
+        if (!WriteFile(file, bytes + done, length, &moved, nullptr)) {
+            throw std::runtime_error("Error writing " + path_);
+        }
+        done += moved;
+    }
+}
+
+size_t IOFile::transfer_at(intptr_t handle, bool write, uint8_t* buffer,
+                           size_t size, size_t required, uint64_t offset) {
+    HANDLE file = reinterpret_cast<HANDLE>(handle);
+    size_t done = 0;
+    while (done < (write ? size : required)) {
+        // The OVERLAPPED offset makes the call positional on a synchronous handle
+        OVERLAPPED overlapped = {};
+        const uint64_t position = offset + done;
+        overlapped.Offset = static_cast<DWORD>(position);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+        const DWORD length = static_cast<DWORD>(std::min<size_t>(size - done, 1u << 30));
+        DWORD moved = 0;
+        const BOOL ok = write
+            ? WriteFile(file, buffer + done, length, &moved, &overlapped)
+            : ReadFile(file, buffer + done, length, &moved, &overlapped);
+        if (!ok) {
+            if (!write && GetLastError() == ERROR_HANDLE_EOF) break;
+            throw std::runtime_error(write ? "Error writing file" : "Error reading file");
+        }
+        if (moved == 0) {
+            if (write) throw std::runtime_error("Error writing file - no progress");
+            break;  // End of file
+        }
+        done += moved;
+    }
+    return done;
+}
+
+std::unique_ptr<AsyncIO> AsyncIO::create_uring(size_t) {
+    return nullptr;
+}
+
+} // namespace binsort
+
+#endif // _WIN32
@@ -0,0 +1,296 @@
+#include "code_arena.hpp"
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace binsort {
+
+namespace {
+
+size_t page_size() {
+#ifndef _WIN32
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    static const size_t size = [] {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+    }();
+#endif
+    return size;
+}
+
+size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+CodeArena& CodeArena::instance() {
+    static CodeArena arena;
+    return arena;
+}
+
+CodeArena::~CodeArena() {
+    for (auto& chunk : chunks_) {
+        unmap_chunk(*chunk);
+    }
+}
+
+std::unique_ptr<CodeArena::Chunk> CodeArena::map_shared_chunk(size_t capacity) {
+#if defined(__linux__)
+    int fd = memfd_create("binsort-jit", MFD_CLOEXEC);
+    if (fd == -1) return nullptr;
+
+    if (ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* write = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void* exec = mmap(nullptr, capacity, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+    close(fd);  // Mappings keep the memory alive
+
+    if (write == MAP_FAILED || exec == MAP_FAILED) {
+        if (write != MAP_FAILED) munmap(write, capacity);
+        if (exec != MAP_FAILED) munmap(exec, capacity);
+        return nullptr;
+    }
+#elif defined(_WIN32)
+    HANDLE mapping = CreateFileMappingW(
+        INVALID_HANDLE_VALUE,
+        nullptr,
+        PAGE_EXECUTE_READWRITE | SEC_COMMIT,
+        0,
+        static_cast<DWORD>(capacity),
+        nullptr
+    );
+    if (mapping == nullptr) return nullptr;
+
+    void* write = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, capacity);
+    void* exec = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, capacity);
+    CloseHandle(mapping);  // Views keep the section alive
+
+    if (write == nullptr || exec == nullptr) {
+        if (write != nullptr) UnmapViewOfFile(write);
+        if (exec != nullptr) UnmapViewOfFile(exec);
+        return nullptr;
+    }
+#else
+    // No anonymous dual mapping available; use private chunks
+    (void)capacity;
+    return nullptr;
+#endif
+
+    auto chunk = std::make_unique<Chunk>();
+    chunk->exec = static_cast<uint8_t*>(exec);
+    chunk->write = static_cast<uint8_t*>(write);
+    chunk->capacity = capacity;
+    chunk->shared = true;
+    chunk->free_blocks[0] = capacity;
+    return chunk;
+}
+
+std::unique_ptr<CodeArena::Chunk> CodeArena::map_private_chunk(const void* code, size_t size) {
+    const size_t capacity = round_up(size, page_size());
+
+#ifndef _WIN32
+    void* memory = mmap(
+        nullptr,
+        capacity,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Failed to allocate executable memory");
+    }
+    std::memcpy(memory, code, size);
+    if (mprotect(memory, capacity, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, capacity);
+        throw std::runtime_error("Failed to make code executable");
+    }
+#else
+    void* memory = VirtualAlloc(nullptr, capacity, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (memory == nullptr) {
+        throw std::runtime_error("Failed to allocate executable memory");
+    }
+    std::memcpy(memory, code, size);
+    DWORD old_protect;
+    if (!VirtualProtect(memory, capacity, PAGE_EXECUTE_READ, &old_protect)) {
+        VirtualFree(memory, 0, MEM_RELEASE);
+        throw std::runtime_error("Failed to make code executable");
+    }
+#endif
+
+    auto chunk = std::make_unique<Chunk>();
+    chunk->exec = static_cast<uint8_t*>(memory);
+    chunk->capacity = capacity;
+    chunk->used_blocks[0] = size;
+    return chunk;
+}
+
+void CodeArena::unmap_chunk(Chunk& chunk) {
+#ifndef _WIN32
+    if (chunk.write != nullptr) munmap(chunk.write, chunk.capacity);
+    if (chunk.exec != nullptr) munmap(chunk.exec, chunk.capacity);
+#else
+    if (chunk.shared) {
+        if (chunk.write != nullptr) UnmapViewOfFile(chunk.write);
+        if (chunk.exec != nullptr) UnmapViewOfFile(chunk.exec);
+    } else if (chunk.exec != nullptr) {
+        VirtualFree(chunk.exec, 0, MEM_RELEASE);
+    }
+#endif
+    chunk.write = nullptr;
+    chunk.exec = nullptr;
+}
+
+bool CodeArena::allocate_block(Chunk& chunk, size_t size, size_t& offset) {
+    // First fit keeps related comparators close together
+    for (auto it = chunk.free_blocks.begin(); it != chunk.free_blocks.end(); ++it) {
+        if (it->second < size) continue;
+
+        offset = it->first;
+        const size_t remaining = it->second - size;
+        chunk.free_blocks.erase(it);
+        if (remaining > 0) {
+            chunk.free_blocks[offset + size] = remaining;
+        }
+        chunk.used_blocks[offset] = size;
+        return true;
+    }
+    return false;
+}
+
+void CodeArena::free_block(Chunk& chunk, size_t offset) {
+    auto used = chunk.used_blocks.find(offset);
+    if (used == chunk.used_blocks.end()) return;
+    size_t size = used->second;
+    chunk.used_blocks.erase(used);
+
+    // Coalesce with the following free block
+    auto next = chunk.free_blocks.find(offset + size);
+    if (next != chunk.free_blocks.end()) {
+        size += next->second;
+        chunk.free_blocks.erase(next);
+    }
+
+    // Coalesce with the preceding free block
+    auto it = chunk.free_blocks.lower_bound(offset);
+    if (it != chunk.free_blocks.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    chunk.free_blocks[offset] = size;
+}
+
+CodeArena::Chunk* CodeArena::find_chunk(const void* func, size_t& offset) const {
+    const auto* address = static_cast<const uint8_t*>(func);
+    for (const auto& chunk : chunks_) {
+        if (address >= chunk->exec && address < chunk->exec + chunk->capacity) {
+            offset = static_cast<size_t>(address - chunk->exec);
+            return chunk.get();
+        }
+    }
+    return nullptr;
+}
+
+void* CodeArena::install(const void* code, size_t size) {
+    if (size == 0) {
+        throw std::invalid_argument("Cannot install empty code");
+    }
+
+    const size_t block_size = round_up(size, kAlignment);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Large functions get their own pages
+    if (block_size <= kChunkSize / 2) {
+        size_t offset = 0;
+        for (auto& chunk : chunks_) {
+            if (chunk->shared && allocate_block(*chunk, block_size, offset)) {
+                std::memcpy(chunk->write + offset, code, size);
+                return chunk->exec + offset;
+            }
+        }
+
+        if (!dual_mapping_failed_) {
+            if (auto chunk = map_shared_chunk(kChunkSize)) {
+                allocate_block(*chunk, block_size, offset);
+                std::memcpy(chunk->write + offset, code, size);
+                void* func = chunk->exec + offset;
+                chunks_.push_back(std::move(chunk));
+                return func;
+            }
+            dual_mapping_failed_ = true;
+        }
+    }
+
+    chunks_.push_back(map_private_chunk(code, size));
+    return chunks_.back()->exec;
+}
+
+void CodeArena::release(void* func) {
+    if (func == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t offset = 0;
+    Chunk* chunk = find_chunk(func, offset);
+    if (chunk == nullptr) return;
+
+    free_block(*chunk, offset);
+
+    // Return empty chunks to the OS, but keep one shared chunk warm
+    if (chunk->used_blocks.empty()) {
+        size_t shared_chunks = 0;
+        for (const auto& c : chunks_) {
+            if (c->shared) ++shared_chunks;
+        }
+        if (chunk->shared && shared_chunks <= 1) return;
+
+        unmap_chunk(*chunk);
+        for (auto it = chunks_.begin(); it != chunks_.end(); ++it) {
+            if (it->get() == chunk) {
+                chunks_.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+size_t CodeArena::size_of(const void* func) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t offset = 0;
+    const Chunk* chunk = find_chunk(func, offset);
+    if (chunk == nullptr) return 0;
+
+    auto it = chunk->used_blocks.find(offset);
+    return it != chunk->used_blocks.end() ? it->second : 0;
+}
+
+size_t CodeArena::mapped_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t total = 0;
+    for (const auto& chunk : chunks_) {
+        total += chunk->capacity;
+    }
+    return total;
+}
+
+} // namespace binsort
@@ -1,15 +1,12 @@
 #include "comparison_generator.hpp"
+#include "code_arena.hpp"
+#include "key_compare.hpp"
+#include <bit>
 #include <cstring>
+#include <map>
+#include <mutex>
 #include <stdexcept>
-
-#ifndef _WIN32
-#include <sys/mman.h>
-#include <unistd.h>
-#else
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <windows.h>
-#endif
+#include <string>
 
 namespace binsort {
 
@@ -22,97 +19,61 @@ bool ComparisonGenerator::is_available() {
 #endif
 }
 
-ComparisonGenerator::CodeBuffer::~CodeBuffer() {
-    if (memory != nullptr) {
-#ifndef _WIN32
-        munmap(memory, capacity);
-#else
-        VirtualFree(memory, 0, MEM_RELEASE);
-#endif
-    }
-}
-
-void ComparisonGenerator::ensure_capacity(CodeBuffer& code, size_t required) {
-    if (code.capacity == 0) {
-        // Initial allocation
-        code.capacity = (required < 4096) ? 4096 : required;
-        
-#ifndef _WIN32
-        code.memory = mmap(
-            nullptr,
-            code.capacity,
-            PROT_READ | PROT_WRITE,
-            MAP_PRIVATE | MAP_ANONYMOUS,
-            -1,
-            0
-        );
-        if (code.memory == MAP_FAILED) {
-            throw std::runtime_error("Failed to allocate code buffer");
-        }
-#else
-        code.memory = VirtualAlloc(
-            nullptr,
-            code.capacity,
-            MEM_COMMIT | MEM_RESERVE,
-            PAGE_READWRITE
-        );
-        if (code.memory == nullptr) {
-            throw std::runtime_error("Failed to allocate code buffer");
-        }
-#endif
-    }
-    else if (code.size + required > code.capacity) {
-        throw std::runtime_error("Code buffer overflow");
-    }
-}
-
 void ComparisonGenerator::emit_byte(CodeBuffer& code, uint8_t byte) {
-    ensure_capacity(code, 1);
-    static_cast<uint8_t*>(code.memory)[code.size++] = byte;
+    code.bytes.push_back(byte);
 }
 
 void ComparisonGenerator::emit_bytes(CodeBuffer& code, const void* bytes, size_t count) {
-    ensure_capacity(code, count);
-    std::memcpy(
-        static_cast<uint8_t*>(code.memory) + code.size,
-        bytes,
-        count
-    );
-    code.size += count;
+    const auto* p = static_cast<const uint8_t*>(bytes);
+    code.bytes.insert(code.bytes.end(), p, p + count);
 }
 
-void ComparisonGenerator::make_executable(CodeBuffer& code) {
-#ifndef _WIN32
-    if (mprotect(code.memory, code.capacity, PROT_READ | PROT_EXEC) != 0) {
-        throw std::runtime_error("Failed to make code executable");
-    }
+namespace {
+
+// x64 register numbers as encoded in ModRM/REX
+constexpr uint8_t REG_RAX = 0;
+constexpr uint8_t REG_R8  = 8;
+constexpr uint8_t REG_R9  = 9;
+
+#ifdef _WIN32
+constexpr uint8_t REG_A = 1;  // rcx: first argument (Windows x64 ABI)
+constexpr uint8_t REG_B = 2;  // rdx: second argument
 #else
-    DWORD old_protect;
-    if (!VirtualProtect(code.memory, code.capacity, PAGE_EXECUTE_READ, &old_protect)) {
-        throw std::runtime_error("Failed to make code executable");
-    }
+constexpr uint8_t REG_A = 7;  // rdi: first argument (System V ABI)
+constexpr uint8_t REG_B = 6;  // rsi: second argument
 #endif
-}
 
-void ComparisonGenerator::emit_prologue(CodeBuffer& code) {
+// Scratch registers, volatile in both ABIs
+constexpr uint8_t REG_X = REG_RAX;
+constexpr uint8_t REG_Y = REG_R8;
+constexpr uint8_t REG_T = REG_R9;
+
+// Condition codes (low nibble of the Jcc/SETcc opcodes)
+constexpr uint8_t CC_B = 0x2;   // below (unsigned <)
+constexpr uint8_t CC_A = 0x7;   // above (unsigned >)
+constexpr uint8_t CC_L = 0xC;   // less (signed <)
+constexpr uint8_t CC_G = 0xF;   // greater (signed >)
+
+// ALU opcodes in "op r/m, reg" form
+constexpr uint8_t OP_XOR = 0x31;
+constexpr uint8_t OP_CMP = 0x39;
+constexpr uint8_t OP_MOV = 0x89;
+
+} // namespace
+
+void ComparisonGenerator::emit_prologue([[maybe_unused]] CodeBuffer& code) {
     // x64 System V ABI: rdi = a, rsi = b
     // x64 Windows ABI: rcx = a, rdx = b
-    
-#ifdef _WIN32
-    // Windows: move rcx -> rdi, rdx -> rsi for consistency
-    uint8_t prologue[] = {
-        0x48, 0x89, 0xcf,  // mov rdi, rcx
-        0x48, 0x89, 0xd6,  // mov rsi, rdx
-    };
-#else
-    // Unix: parameters already in rdi, rsi
+    // Generated code addresses the records through the argument registers
+    // directly and only uses volatile scratch registers, so no callee-saved
+    // state needs to be preserved.
+#ifndef _WIN32
     uint8_t prologue[] = {
         0x55,              // push rbp
         0x48, 0x89, 0xe5,  // mov rbp, rsp
     };
-#endif
-    
     emit_bytes(code, prologue, sizeof(prologue));
+#endif
 }
 
 void ComparisonGenerator::emit_epilogue(CodeBuffer& code) {
@@ -131,20 +92,291 @@ void ComparisonGenerator::emit_epilogue(CodeBuffer& code) {
     emit_bytes(code, epilogue, sizeof(epilogue));
 }
 
+void ComparisonGenerator::emit_rex(CodeBuffer& code, bool wide, uint8_t reg, uint8_t rm) {
+    uint8_t rex = 0x40;
+    if (wide) rex |= 0x08;
+    if (reg & 8) rex |= 0x04;
+    if (rm & 8) rex |= 0x01;
+    if (rex != 0x40) {
+        emit_byte(code, rex);
+    }
+}
+
+void ComparisonGenerator::emit_mem_operand(
+    CodeBuffer& code,
+    uint8_t reg,
+    uint8_t base,
+    size_t disp
+) {
+    if (disp > 0x7fffffff) {
+        throw std::out_of_range("Key offset too large for JIT addressing");
+    }
+
+    const uint8_t r = (reg & 7) << 3;
+    const uint8_t b = base & 7;
+
+    if (disp == 0 && b != 5) {
+        emit_byte(code, 0x00 | r | b);                  // [base]
+        if (b == 4) emit_byte(code, 0x24);              // SIB for rsp/r12
+    } else if (disp <= 0x7f) {
+        emit_byte(code, 0x40 | r | b);                  // [base + disp8]
+        if (b == 4) emit_byte(code, 0x24);
+        emit_byte(code, static_cast<uint8_t>(disp));
+    } else {
+        emit_byte(code, 0x80 | r | b);                  // [base + disp32]
+        if (b == 4) emit_byte(code, 0x24);
+        uint32_t d = static_cast<uint32_t>(disp);
+        emit_bytes(code, &d, sizeof(d));
+    }
+}
+
+void ComparisonGenerator::emit_load(
+    CodeBuffer& code,
+    uint8_t dst,
+    uint8_t base,
+    size_t disp,
+    size_t width
+) {
+    switch (width) {
+        case 1:  // movzx r32, byte [base + disp]
+            emit_rex(code, false, dst, base);
+            emit_byte(code, 0x0f);
+            emit_byte(code, 0xb6);
+            break;
+        case 2:  // movzx r32, word [base + disp]
+            emit_rex(code, false, dst, base);
+            emit_byte(code, 0x0f);
+            emit_byte(code, 0xb7);
+            break;
+        case 4:  // mov r32, dword [base + disp]
+            emit_rex(code, false, dst, base);
+            emit_byte(code, 0x8b);
+            break;
+        case 8:  // mov r64, qword [base + disp]
+            emit_rex(code, true, dst, base);
+            emit_byte(code, 0x8b);
+            break;
+        default:
+            throw std::invalid_argument("Invalid load width");
+    }
+    emit_mem_operand(code, dst, base, disp);
+}
+
+void ComparisonGenerator::emit_byteswap(CodeBuffer& code, uint8_t reg, size_t width) {
+    switch (width) {
+        case 1:
+            break;
+        case 2:  // rol r16, 8
+            emit_byte(code, 0x66);
+            emit_rex(code, false, 0, reg);
+            emit_byte(code, 0xc1);
+            emit_byte(code, 0xc0 | (reg & 7));
+            emit_byte(code, 8);
+            break;
+        case 4:  // bswap r32
+        case 8:  // bswap r64
+            emit_rex(code, width == 8, 0, reg);
+            emit_byte(code, 0x0f);
+            emit_byte(code, 0xc8 | (reg & 7));
+            break;
+        default:
+            throw std::invalid_argument("Invalid byte swap width");
+    }
+}
+
+void ComparisonGenerator::emit_sign_extend16(CodeBuffer& code, uint8_t reg) {
+    // movsx r32, r16
+    emit_rex(code, false, reg, reg);
+    emit_byte(code, 0x0f);
+    emit_byte(code, 0xbf);
+    emit_byte(code, 0xc0 | ((reg & 7) << 3) | (reg & 7));
+}
+
+void ComparisonGenerator::emit_reg_op(
+    CodeBuffer& code,
+    uint8_t opcode,
+    bool wide,
+    uint8_t dst,
+    uint8_t src
+) {
+    // op dst, src  ("op r/m, reg" encoding)
+    emit_rex(code, wide, src, dst);
+    emit_byte(code, opcode);
+    emit_byte(code, 0xc0 | ((src & 7) << 3) | (dst & 7));
+}
+
+void ComparisonGenerator::emit_shift(
+    CodeBuffer& code,
+    uint8_t ext,
+    bool wide,
+    uint8_t reg,
+    uint8_t amount
+) {
+    // C1 /ext ib: shl=4, shr=5, sar=7
+    emit_rex(code, wide, 0, reg);
+    emit_byte(code, 0xc1);
+    emit_byte(code, 0xc0 | (ext << 3) | (reg & 7));
+    emit_byte(code, amount);
+}
+
+void ComparisonGenerator::emit_float_to_ordered(CodeBuffer& code, uint8_t reg, bool wide) {
+    // IEEE 754 totalOrder as a signed integer compare:
+    //   x ^= (x >>s (bits-1)) >>u 1
+    // flips the magnitude bits of negative values so that more negative
+    // floats compare lower; -NaN < -inf < -0 < +0 < +inf < +NaN.
+    const uint8_t bits = wide ? 64 : 32;
+    emit_reg_op(code, OP_MOV, wide, REG_T, reg);   // mov t, reg
+    emit_shift(code, 7, wide, REG_T, bits - 1);    // sar t, bits-1
+    emit_shift(code, 5, wide, REG_T, 1);           // shr t, 1
+    emit_reg_op(code, OP_XOR, wide, reg, REG_T);   // xor reg, t
+}
+
+void ComparisonGenerator::emit_field_comparison(
+    CodeBuffer& code,
+    size_t offset,
+    size_t width,
+    KeyType type,
+    SortOrder order
+) {
+    const bool wide = (width == 8);
+    const bool is_signed = (type != KeyType::Character);
+    // Character keys are compared like memcmp: big-endian unsigned chunks
+    const bool swap = (type == KeyType::Character || type == KeyType::BigEndianInt);
+
+    emit_load(code, REG_X, REG_A, offset, width);
+    emit_load(code, REG_Y, REG_B, offset, width);
+
+    if (swap) {
+        emit_byteswap(code, REG_X, width);
+        emit_byteswap(code, REG_Y, width);
+    }
+
+    if (is_signed && width == 2) {
+        emit_sign_extend16(code, REG_X);
+        emit_sign_extend16(code, REG_Y);
+    }
+
+    if (type == KeyType::LittleEndianFloat) {
+        // 2-byte (half precision) values are sign-extended above, which
+        // keeps the same ordering under the 32-bit transform
+        emit_float_to_ordered(code, REG_X, wide);
+        emit_float_to_ordered(code, REG_Y, wide);
+    }
+
+    emit_reg_op(code, OP_CMP, wide, REG_X, REG_Y);  // cmp x, y
+
+    // je next (patched below)
+    emit_byte(code, 0x74);
+    emit_byte(code, 0x00);
+    const size_t jump_patch = code.size();
+
+    // Values differ: eax = (a "after" b) ? 1 : -1
+    uint8_t cc;
+    if (order == SortOrder::Ascending) {
+        cc = is_signed ? CC_G : CC_A;
+    } else {
+        cc = is_signed ? CC_L : CC_B;
+    }
+    uint8_t set_result[] = {
+        0x0f, static_cast<uint8_t>(0x90 | cc), 0xc0,  // setcc al
+        0x0f, 0xb6, 0xc0,                              // movzx eax, al
+        0x8d, 0x44, 0x00, 0xff,                        // lea eax, [rax + rax - 1]
+    };
+    emit_bytes(code, set_result, sizeof(set_result));
+    emit_epilogue(code);
+
+    const size_t distance = code.size() - jump_patch;
+    code.bytes[jump_patch - 1] = static_cast<uint8_t>(distance);
+}
+
 void ComparisonGenerator::emit_key_comparison(
-    [[maybe_unused]] CodeBuffer& code,
-    [[maybe_unused]] const KeySpec& spec,
-    [[maybe_unused]] size_t record_length
+    CodeBuffer& code,
+    const KeySpec& spec,
+    size_t record_length
+) {
+    if (spec.position == 0 || spec.offset() + spec.length > record_length) {
+        throw std::out_of_range("Key extends beyond record boundary");
+    }
+
+    if (spec.type == KeyType::Character) {
+        // memcmp over the key in the widest chunks available, exiting at the
+        // first chunk that differs
+        size_t offset = spec.offset();
+        size_t remaining = spec.length;
+        while (remaining > 0) {
+            size_t width = remaining >= 8 ? 8 : remaining >= 4 ? 4 : remaining >= 2 ? 2 : 1;
+            emit_field_comparison(code, offset, width, spec.type, spec.order);
+            offset += width;
+            remaining -= width;
+        }
+        return;
+    }
+
+    if (spec.length != 2 && spec.length != 4 && spec.length != 8) {
+        throw std::invalid_argument("Invalid numeric key length");
+    }
+    emit_field_comparison(code, spec.offset(), spec.length, spec.type, spec.order);
+}
+
+namespace {
+
+struct CachedFunction {
+    ComparisonFunc func = nullptr;
+    size_t refs = 0;
+    uint64_t last_use = 0;
+};
+
+// Generated comparators keyed by layout; idle entries (refs == 0) stay
+// installed so the next sort with the same layout skips codegen
+struct FunctionCache {
+    std::mutex mutex;
+    std::map<std::string, CachedFunction> by_layout;
+    std::map<ComparisonFunc, std::string> by_func;
+    uint64_t clock = 0;
+};
+
+FunctionCache& function_cache() {
+    static FunctionCache cache;
+    return cache;
+}
+
+std::string layout_key(const std::vector<KeySpec>& keys, size_t record_length) {
+    std::string key;
+    auto append = [&key](uint64_t value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    append(record_length);
+    for (const auto& spec : keys) {
+        append(spec.position);
+        append(spec.length);
+        append(static_cast<uint64_t>(spec.type));
+        append(static_cast<uint64_t>(spec.order));
+    }
+    return key;
+}
+
+} // namespace
+
+ComparisonFunc ComparisonGenerator::compile(
+    const std::vector<KeySpec>& keys,
+    size_t record_length
 ) {
-    // This is a simplified version - full implementation would generate
-    // optimized assembly for each key type
+    CodeBuffer code;
+    emit_prologue(code);
+    
+    // Generate comparison code for each key
+    for (const auto& key : keys) {
+        emit_key_comparison(code, key, record_length);
+    }
     
-    // For now, this is a placeholder showing the structure
-    // Real implementation would emit:
-    // 1. Load values from records at specified offsets
-    // 2. Perform endianness conversion if needed
-    // 3. Compare values
-    // 4. Jump to next key if equal, return if not
+    // If all keys equal, return 0
+    uint8_t ret_zero[] = {0x31, 0xc0};  // xor eax, eax
+    emit_bytes(code, ret_zero, sizeof(ret_zero));
+    
+    emit_epilogue(code);
+
+    void* memory = CodeArena::instance().install(code.bytes.data(), code.size());
+    return reinterpret_cast<ComparisonFunc>(memory);
 }
 
 ComparisonFunc ComparisonGenerator::generate(
@@ -152,75 +384,179 @@ ComparisonFunc ComparisonGenerator::generate(
     size_t record_length
 ) {
     if (!is_available()) {
-        // Fall back to interpreted comparison
-        return InterpretedComparator::wrap(keys);
+        return nullptr;
     }
 
-    CodeBuffer code;
-    
+    auto& cache = function_cache();
+    const std::string layout = layout_key(keys, record_length);
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto it = cache.by_layout.find(layout);
+    if (it != cache.by_layout.end()) {
+        it->second.refs++;
+        it->second.last_use = ++cache.clock;
+        return it->second.func;
+    }
+
+    ComparisonFunc func;
     try {
-        emit_prologue(code);
-        
-        // Generate comparison code for each key
-        for (const auto& key : keys) {
-            emit_key_comparison(code, key, record_length);
-        }
-        
-        // If all keys equal, return 0
-        // mov eax, 0
-        uint8_t ret_zero[] = {0x31, 0xc0};  // xor eax, eax
-        emit_bytes(code, ret_zero, sizeof(ret_zero));
-        
-        emit_epilogue(code);
-        make_executable(code);
-        
-        // Return function pointer (ownership transferred)
-        ComparisonFunc func = reinterpret_cast<ComparisonFunc>(code.memory);
-        code.memory = nullptr;  // Prevent destructor from freeing
-        return func;
+        func = compile(keys, record_length);
     }
     catch (...) {
-        // Fall back to interpreted version on error
-        return InterpretedComparator::wrap(keys);
+        // Caller falls back to the interpreted comparator
+        return nullptr;
     }
+
+    cache.by_layout[layout] = {func, 1, ++cache.clock};
+    cache.by_func[func] = layout;
+    return func;
 }
 
 void ComparisonGenerator::free_function(ComparisonFunc func) {
     if (func == nullptr) return;
-    
-    // For now, we don't track generated functions
-    // In production, we'd need a registry to know the size
-#ifndef _WIN32
-    // Cannot free without knowing size
-#else
-    VirtualFree(reinterpret_cast<void*>(func), 0, MEM_RELEASE);
-#endif
+
+    auto& cache = function_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto owner = cache.by_func.find(func);
+    if (owner == cache.by_func.end()) {
+        return;  // Not generated by us (e.g. interpreted fallback)
+    }
+
+    auto& entry = cache.by_layout[owner->second];
+    if (entry.refs > 0 && --entry.refs > 0) return;
+
+    // Evict least recently used idle functions beyond the limit
+    size_t idle = 0;
+    for (const auto& [layout, cached] : cache.by_layout) {
+        if (cached.refs == 0) ++idle;
+    }
+    while (idle > kMaxIdleFunctions) {
+        auto victim = cache.by_layout.end();
+        for (auto i = cache.by_layout.begin(); i != cache.by_layout.end(); ++i) {
+            if (i->second.refs == 0 &&
+                (victim == cache.by_layout.end() || i->second.last_use < victim->second.last_use)) {
+                victim = i;
+            }
+        }
+        CodeArena::instance().release(reinterpret_cast<void*>(victim->second.func));
+        cache.by_func.erase(victim->second.func);
+        cache.by_layout.erase(victim);
+        --idle;
+    }
 }
 
 // Interpreted comparator implementation
-int InterpretedComparator::compare(const uint8_t* a, const uint8_t* b) const {
-    RecordView va(a, 1000000);  // Size doesn't matter for comparison
-    RecordView vb(b, 1000000);
-    
-    RecordComparator cmp(keys_);
-    return cmp.compare(va, vb);
+namespace {
+
+// Per-field comparators of the interpreter steps
+template <KeyType Type, size_t N, SortOrder Order>
+int compare_numeric(const uint8_t* a, const uint8_t* b, size_t) {
+    return key_compare::compare_numeric<Type, N, Order>(a, b);
+}
+
+template <SortOrder Order>
+int compare_chars(const uint8_t* a, const uint8_t* b, size_t length) {
+    return key_compare::compare_chars<Order>(a, b, length);
 }
 
-// Global storage for interpreted comparator instance
-static InterpretedComparator* g_comparator = nullptr;
+// Whole-record comparators for single-key plans; the context points at
+// the key offset
+template <KeyType Type, size_t N, SortOrder Order>
+int single_numeric(const uint8_t* a, const uint8_t* b, const void* context) {
+    const size_t offset = *static_cast<const size_t*>(context);
+    return compare_numeric<Type, N, Order>(a + offset, b + offset, N);
+}
 
-static int interpreted_compare_wrapper(const uint8_t* a, const uint8_t* b) {
-    if (g_comparator == nullptr) {
-        return 0;  // Should never happen
+template <KeyType Type, SortOrder Order>
+struct NumericPlan {
+    static int (*field(size_t length))(const uint8_t*, const uint8_t*, size_t) {
+        switch (length) {
+            case 2: return compare_numeric<Type, 2, Order>;
+            case 4: return compare_numeric<Type, 4, Order>;
+            case 8: return compare_numeric<Type, 8, Order>;
+        }
+        throw std::invalid_argument("Numeric key length must be 2, 4, or 8 bytes");
+    }
+
+    static ComparisonFunc single(size_t length) {
+        switch (length) {
+            case 2: return single_numeric<Type, 2, Order>;
+            case 4: return single_numeric<Type, 4, Order>;
+            case 8: return single_numeric<Type, 8, Order>;
+        }
+        throw std::invalid_argument("Numeric key length must be 2, 4, or 8 bytes");
+    }
+};
+
+template <KeyType Type>
+void select_numeric(const KeySpec& spec,
+                    int (*&field)(const uint8_t*, const uint8_t*, size_t),
+                    ComparisonFunc& single) {
+    if (spec.order == SortOrder::Ascending) {
+        field = NumericPlan<Type, SortOrder::Ascending>::field(spec.length);
+        single = NumericPlan<Type, SortOrder::Ascending>::single(spec.length);
+    } else {
+        field = NumericPlan<Type, SortOrder::Descending>::field(spec.length);
+        single = NumericPlan<Type, SortOrder::Descending>::single(spec.length);
+    }
+}
+
+} // namespace
+
+InterpretedComparator::InterpretedComparator(const std::vector<KeySpec>& keys) {
+    steps_.reserve(keys.size());
+
+    for (const auto& key : keys) {
+        if (key.position == 0) {
+            throw std::invalid_argument("Key position must be >= 1 (1-based)");
+        }
+
+        Step step{key.offset(), key.length, nullptr, nullptr};
+        switch (key.type) {
+            case KeyType::Character:
+                step.compare = key.order == SortOrder::Ascending
+                    ? compare_chars<SortOrder::Ascending>
+                    : compare_chars<SortOrder::Descending>;
+                break;
+            case KeyType::LittleEndianInt:
+                select_numeric<KeyType::LittleEndianInt>(key, step.compare, step.single);
+                break;
+            case KeyType::BigEndianInt:
+                select_numeric<KeyType::BigEndianInt>(key, step.compare, step.single);
+                break;
+            case KeyType::LittleEndianFloat:
+                select_numeric<KeyType::LittleEndianFloat>(key, step.compare, step.single);
+                break;
+        }
+        steps_.push_back(step);
     }
-    return g_comparator->compare(a, b);
 }
 
-ComparisonFunc InterpretedComparator::wrap(const std::vector<KeySpec>& keys) {
-    // Note: This leaks memory intentionally since the comparator must live
-    // as long as the function pointer is in use
-    g_comparator = new InterpretedComparator(keys);
-    return interpreted_compare_wrapper;
+int InterpretedComparator::compare(const uint8_t* a, const uint8_t* b) const {
+    for (const Step& step : steps_) {
+        const int cmp = step.compare(a + step.offset, b + step.offset, step.length);
+        if (cmp != 0) {
+            return cmp;
+        }
+    }
+    return 0;
+}
+
+int InterpretedComparator::compare_thunk(
+    const uint8_t* a,
+    const uint8_t* b,
+    const void* context
+) {
+    return static_cast<const InterpretedComparator*>(context)->compare(a, b);
+}
+
+Comparator InterpretedComparator::bind() const {
+    if (steps_.size() == 1 && steps_[0].single != nullptr) {
+        return {steps_[0].single, &steps_[0].offset};
+    }
+    return {compare_thunk, this};
 }
 
 } // namespace binsort
@@ -0,0 +1,493 @@
+#include "external_sort.hpp"
+#include "async_io.hpp"
+#include "file_operations.hpp"
+#include "loser_tree.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <filesystem>
+#include <random>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace binsort {
+
+namespace {
+
+// Descriptors left free when sizing a merge: the output, the input and
+// standard streams, I/O queues and whatever else the process holds
+constexpr size_t kReservedDescriptors = 64;
+
+// Files a merge may have open at once, input runs and output together
+size_t open_file_limit() {
+#ifndef _WIN32
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        const size_t soft = static_cast<size_t>(limit.rlim_cur);
+        return soft > kReservedDescriptors + 3 ? soft - kReservedDescriptors : 3;
+    }
+#endif
+    return std::numeric_limits<size_t>::max();
+}
+
+/**
+ * Sequential reader over a file of records, double-buffered: the next
+ * block is read asynchronously while the current one is consumed
+ *
+ * Given a comparator it also checks that the file is sorted, comparing
+ * each record with the one before it.
+ */
+class RunReader {
+public:
+    RunReader(AsyncIO& io, const std::string& path, bool direct, size_t record_length, size_t block_bytes,
+              const Comparator* order = nullptr)
+        : io_(io)
+        , file_(path, IOFile::Mode::Read, direct)
+        , record_length_(record_length)
+        , size_(FileOperations::get_file_size(path))
+        , order_(order) {
+        if (size_ % record_length != 0) {
+            throw std::runtime_error(
+                "File size of " + path + " (" + std::to_string(size_) +
+                ") is not divisible by record length (" +
+                std::to_string(record_length) + ")"
+            );
+        }
+        if (order_ != nullptr) {
+            last_.resize(record_length);
+        }
+        buffers_[0] = IOBuffer(block_bytes);
+        buffers_[1] = IOBuffer(block_bytes);
+        fetch();
+        refill();
+    }
+
+    ~RunReader() {
+        try {
+            io_.wait(pending_);
+        } catch (...) {
+        }
+    }
+
+    // Current record, nullptr once the file is exhausted
+    const uint8_t* head() const {
+        return pos_ < end_ ? buffers_[current_].data() + pos_ : nullptr;
+    }
+
+    // Move past the current record; invalidates earlier head() pointers
+    const uint8_t* advance() {
+        const uint8_t* previous = head();
+        pos_ += record_length_;
+        index_++;
+        if (pos_ >= end_) {
+            // The block being left is about to be read over
+            if (order_ != nullptr) {
+                std::memcpy(last_.data(), previous, record_length_);
+                previous = last_.data();
+            }
+            refill();
+        }
+        const uint8_t* next = head();
+        if (order_ != nullptr && next != nullptr && (*order_)(previous, next) > 0) {
+            throw std::runtime_error(
+                "Input is not sorted: " + file_.path() + " record " + std::to_string(index_ + 1) +
+                " sorts before record " + std::to_string(index_)
+            );
+        }
+        return next;
+    }
+
+private:
+    AsyncIO& io_;
+    IOFile file_;
+    size_t record_length_;
+    uint64_t size_;
+    const Comparator* order_;
+    std::vector<uint8_t> last_;    // Copy of the last record of the previous block
+    uint64_t index_ = 0;           // Number of the current record
+    uint64_t offset_ = 0;
+    IOBuffer buffers_[2];
+    size_t current_ = 1;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+    uint64_t pending_ = 0;         // Read into the other buffer, 0 if none
+    size_t pending_bytes_ = 0;
+
+    // Start reading the next block into the buffer not being consumed
+    void fetch() {
+        const size_t back = current_ ^ 1;
+        pending_bytes_ = static_cast<size_t>(std::min<uint64_t>(buffers_[back].size(), size_ - offset_));
+        pending_ = pending_bytes_ > 0 ? io_.read(file_, buffers_[back].data(), pending_bytes_, offset_) : 0;
+        offset_ += pending_bytes_;
+    }
+
+    void refill() {
+        const uint64_t pending = pending_;
+        pending_ = 0;
+        io_.wait(pending);
+        current_ ^= 1;
+        pos_ = 0;
+        end_ = pending_bytes_;
+        if (end_ > 0) fetch();
+    }
+};
+
+/**
+ * Sequential writer that flushes in large blocks, writing one buffer
+ * asynchronously while filling the other
+ */
+class RunWriter {
+public:
+    RunWriter(AsyncIO& io, const std::string& path, bool direct, size_t record_length, size_t block_bytes)
+        : io_(io)
+        , file_(path, IOFile::Mode::Write, direct)
+        , record_length_(record_length) {
+        buffers_[0] = IOBuffer(block_bytes);
+        buffers_[1] = IOBuffer(block_bytes);
+    }
+
+    ~RunWriter() {
+        try {
+            io_.wait(pending_);
+        } catch (...) {
+        }
+    }
+
+    void write(const uint8_t* record) {
+        std::memcpy(buffers_[current_].data() + fill_, record, record_length_);
+        fill_ += record_length_;
+        if (fill_ + record_length_ > buffers_[current_].size()) flush();
+    }
+
+    void finish() {
+        flush();
+        const uint64_t pending = pending_;
+        pending_ = 0;
+        io_.wait(pending);
+    }
+
+private:
+    AsyncIO& io_;
+    IOFile file_;
+    size_t record_length_;
+    IOBuffer buffers_[2];
+    size_t current_ = 0;
+    size_t fill_ = 0;
+    uint64_t offset_ = 0;
+    uint64_t pending_ = 0;         // Write from the other buffer, 0 if none
+
+    void flush() {
+        if (fill_ == 0) return;
+        if (!file_.seekable()) {
+            // Pipes take writes in order only
+            file_.write_next(buffers_[current_].data(), fill_);
+            fill_ = 0;
+            return;
+        }
+        const uint64_t write = io_.write(file_, buffers_[current_].data(), fill_, offset_);
+        offset_ += fill_;
+        fill_ = 0;
+
+        // The other buffer is reused once its write has landed
+        const uint64_t previous = pending_;
+        pending_ = write;
+        io_.wait(previous);
+        current_ ^= 1;
+    }
+};
+
+// Waits for outstanding transfers before the buffers they use go away
+class DrainGuard {
+public:
+    explicit DrainGuard(AsyncIO& io) : io_(io) {}
+    ~DrainGuard() {
+        try {
+            io_.wait_all();
+        } catch (...) {
+        }
+    }
+
+private:
+    AsyncIO& io_;
+};
+
+} // namespace
+
+ExternalSort::ExternalSort(const Config& config, SortEngine& engine)
+    : config_(config)
+    , engine_(engine)
+    , io_(AsyncIO::create()) {
+    if (config_.record_length == 0) {
+        throw std::invalid_argument("Record length cannot be zero");
+    }
+
+    std::random_device random;
+    const uint64_t token = (uint64_t(random()) << 32) | random();
+    char name[32];
+    std::snprintf(name, sizeof(name), "binsort-%016llx-", static_cast<unsigned long long>(token));
+    run_prefix_ = name;
+}
+
+ExternalSort::~ExternalSort() {
+    for (const auto& path : live_runs_) {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+    }
+}
+
+size_t ExternalSort::io_unit() const {
+    if (!config_.direct_io) return config_.record_length;
+    return std::lcm(config_.record_length, IOFile::kDirectAlignment);
+}
+
+size_t ExternalSort::fan_in() const {
+    const size_t buffer = std::max(config_.min_merge_buffer, config_.record_length);
+    // A larger budget beyond the descriptor limit goes into larger
+    // buffers per run, since merge_runs splits it over the runs it opens
+    const size_t buffers = std::min(config_.memory_budget / buffer, open_file_limit());
+    return buffers > 3 ? buffers - 1 : 2;
+}
+
+std::string ExternalSort::new_run_path() {
+    std::filesystem::path directory = config_.temp_directory;
+    std::string path = (directory / (run_prefix_ + std::to_string(next_run_++) + ".run")).string();
+    live_runs_.push_back(path);
+    return path;
+}
+
+bool ExternalSort::owns_run(const std::string& path) const {
+    return std::find(live_runs_.begin(), live_runs_.end(), path) != live_runs_.end();
+}
+
+void ExternalSort::remove_run(const std::string& path) {
+    std::filesystem::remove(path);
+    live_runs_.erase(std::find(live_runs_.begin(), live_runs_.end(), path));
+}
+
+void ExternalSort::choose_temp_directory(const std::string& output) {
+    if (config_.temp_directory.empty()) {
+        config_.temp_directory = (output == IOFile::kStandardStream)
+            ? std::filesystem::temp_directory_path().string()
+            : std::filesystem::absolute(output).parent_path().string();
+    }
+}
+
+ExternalSort::Stats ExternalSort::sort(const std::string& input, const std::string& output) {
+    choose_temp_directory(output);
+
+    Stats stats;
+    std::vector<std::string> runs = form_runs(input, output, stats);
+    stats.runs = runs.size();
+    if (runs.empty()) return stats;
+
+    merge_all(runs, output, stats);
+    return stats;
+}
+
+ExternalSort::Stats ExternalSort::merge(const std::vector<std::string>& inputs, const std::string& output) {
+    if (inputs.empty()) {
+        throw std::invalid_argument("Nothing to merge");
+    }
+    for (const auto& input : inputs) {
+        if (FileOperations::is_stream(input)) {
+            throw std::runtime_error("Merge inputs must be files: " + input);
+        }
+        if (FileOperations::is_same_file(input, output)) {
+            throw std::runtime_error("Merge output cannot be one of its inputs: " + input);
+        }
+    }
+    choose_temp_directory(output);
+
+    Stats stats;
+    merge_all(inputs, output, stats);
+    return stats;
+}
+
+void ExternalSort::merge_all(std::vector<std::string> runs, const std::string& output, Stats& stats) {
+    // Intermediate passes merge fan_in() runs at a time, preserving run
+    // order so equal records keep their input order
+    const size_t fan = fan_in();
+    while (runs.size() > fan) {
+        std::vector<std::string> merged;
+        for (size_t begin = 0; begin < runs.size(); begin += fan) {
+            const size_t end = std::min(runs.size(), begin + fan);
+            if (end - begin == 1) {
+                merged.push_back(runs[begin]);
+                continue;
+            }
+            std::vector<std::string> group(runs.begin() + begin, runs.begin() + end);
+            const std::string path = new_run_path();
+            merge_runs(group, path, false);
+            for (const auto& run : group) {
+                if (owns_run(run)) remove_run(run);
+            }
+            merged.push_back(path);
+        }
+        runs.swap(merged);
+        stats.merge_passes++;
+    }
+
+    stats.output_records = merge_runs(runs, output, true);
+    for (const auto& run : runs) {
+        if (owns_run(run)) remove_run(run);
+    }
+    stats.merge_passes++;
+}
+
+std::vector<std::string> ExternalSort::form_runs(const std::string& input, const std::string& output, Stats& stats) {
+    const size_t record_length = config_.record_length;
+
+    IOFile in(input, IOFile::Mode::Read, config_.direct_io);
+    const bool stream = !in.seekable();
+    uint64_t input_bytes = 0;
+    if (!stream) {
+        input_bytes = in.size();
+        if (input_bytes % record_length != 0) {
+            throw std::runtime_error(
+                "File size (" + std::to_string(input_bytes) +
+                ") is not divisible by record length (" +
+                std::to_string(record_length) + ")"
+            );
+        }
+    }
+
+    // A quarter of the budget each for the run being read, the run being
+    // sorted, its sorted copy and the previous sorted run being written.
+    // Runs start on whole I/O units so direct reads of the input stay
+    // aligned. A stream of unknown length gets full-size buffers
+    const size_t unit_records = io_unit() / record_length;
+    const size_t run_records = std::max(unit_records,
+                                        config_.memory_budget / 4 / io_unit() * unit_records);
+    const size_t run_bytes = run_records * record_length;
+    const size_t buffer_bytes = stream ? run_bytes : static_cast<size_t>(std::min<uint64_t>(run_bytes, input_bytes));
+
+    IOBuffer unsorted[2] = {IOBuffer(buffer_bytes), IOBuffer(buffer_bytes)};
+    IOBuffer sorted[2] = {IOBuffer(buffer_bytes), IOBuffer(buffer_bytes)};
+    std::unique_ptr<IOFile> run_files[2];
+    uint64_t writes[2] = {0, 0};
+    DrainGuard drain(*io_);
+
+    // Start fetching a run: files are read asynchronously, streams in
+    // place. next_bytes is the run's size, 0 once the input is exhausted
+    uint64_t read = 0;
+    size_t next_bytes = 0;
+    const auto fetch = [&](size_t run, uint8_t* buffer) {
+        if (stream) {
+            next_bytes = in.read_next(buffer, run_bytes);
+            if (next_bytes % record_length != 0) {
+                throw std::runtime_error("Input size is not divisible by record length (" +
+                                         std::to_string(record_length) + ")");
+            }
+            return;
+        }
+        const uint64_t offset = uint64_t(run) * run_bytes;
+        next_bytes = static_cast<size_t>(std::min<uint64_t>(run_bytes, input_bytes - std::min(offset, input_bytes)));
+        read = next_bytes > 0 ? io_->read(in, buffer, next_bytes, offset) : 0;
+    };
+
+    // Input that fits in one run goes straight to the output, which may
+    // be a pipe
+    const auto write_output = [&](const uint8_t* data, size_t bytes) {
+        IOFile out(output, IOFile::Mode::Write, config_.direct_io);
+        if (bytes == 0) return;
+        if (out.seekable()) {
+            io_->wait(io_->write(out, data, bytes, 0));
+        } else {
+            out.write_next(data, bytes);
+        }
+    };
+
+    std::vector<std::string> runs;
+    fetch(0, unsorted[0].data());
+    if (next_bytes == 0) {
+        write_output(nullptr, 0);
+        return runs;
+    }
+
+    for (size_t run = 0; next_bytes > 0; ++run) {
+        const size_t slot = run % 2;
+        const size_t bytes = next_bytes;
+        io_->wait(read);
+        read = 0;
+        fetch(run + 1, unsorted[slot ^ 1].data());
+
+        // Two runs back, this slot's sorted buffer was still being written
+        io_->wait(writes[slot]);
+        writes[slot] = 0;
+        run_files[slot].reset();
+
+        engine_.sort(unsorted[slot].data(), sorted[slot].data(), bytes / record_length);
+
+        if (run == 0 && next_bytes == 0) {
+            // Everything fit in one run; the input has been fully read
+            GroupReducer groups(record_length, engine_.get_comparator(), config_.groups);
+            stats.output_records = groups.reduce(sorted[slot].data(), bytes / record_length);
+            write_output(sorted[slot].data(), stats.output_records * record_length);
+            return runs;
+        }
+
+        const std::string path = new_run_path();
+        run_files[slot] = std::make_unique<IOFile>(path, IOFile::Mode::Write, config_.direct_io);
+        writes[slot] = io_->write(*run_files[slot], sorted[slot].data(), bytes, 0);
+        runs.push_back(path);
+    }
+
+    io_->wait(writes[0]);
+    io_->wait(writes[1]);
+    return runs;
+}
+
+size_t ExternalSort::merge_runs(const std::vector<std::string>& runs, const std::string& output, bool final) {
+    const size_t record_length = config_.record_length;
+
+    // Every run and the output get an equal share of the budget
+    const size_t share = config_.memory_budget / (runs.size() + 1);
+    // Each stream double-buffers in blocks of whole I/O units
+    const size_t block_bytes = std::max(io_unit(), share / 2 / io_unit() * io_unit());
+
+    // Runs spilled here are sorted; files given to merge() are checked
+    const Comparator compare = engine_.get_comparator();
+    std::vector<std::unique_ptr<RunReader>> readers;
+    std::vector<const uint8_t*> heads;
+    for (const auto& run : runs) {
+        const Comparator* order = owns_run(run) ? nullptr : &compare;
+        readers.push_back(std::make_unique<RunReader>(*io_, run, config_.direct_io, record_length, block_bytes, order));
+        heads.push_back(readers.back()->head());
+    }
+
+    RunWriter writer(*io_, output, config_.direct_io, record_length, block_bytes);
+    LoserTree tree(runs.size(), compare);
+    tree.reset(heads);
+
+    // Intermediate passes keep every record; only the output is reduced
+    GroupReducer::Config reduction;
+    if (final) reduction = config_.groups;
+    GroupReducer groups(record_length, compare, reduction);
+    std::vector<uint8_t> emitted(record_length);
+    size_t written = 0;
+
+    while (!tree.empty()) {
+        const size_t source = tree.winner();
+        if (!reduction.active()) {
+            writer.write(tree.winner_record());
+            written++;
+        } else if (groups.add(tree.winner_record(), emitted.data())) {
+            writer.write(emitted.data());
+            written++;
+        }
+        tree.replace_winner(readers[source]->advance());
+    }
+    if (groups.finish(emitted.data())) {
+        writer.write(emitted.data());
+        written++;
+    }
+    writer.finish();
+    return written;
+}
+
+} // namespace binsort
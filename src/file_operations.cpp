@@ -1,4 +1,6 @@
 #include "file_operations.hpp"
+#include "async_io.hpp"
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
 #include <cstring>
@@ -7,6 +9,12 @@
 #ifndef _WIN32
 #include <sys/stat.h>
 #include <unistd.h>
+#include <errno.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
 #else
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -15,6 +23,68 @@
 
 namespace binsort {
 
+namespace {
+
+#ifdef __linux__
+// Errors meaning the call cannot be used for this pair of files, as
+// opposed to an I/O failure
+bool unsupported(int error) {
+    return error == ENOSYS || error == EXDEV || error == EINVAL ||
+           error == EOPNOTSUPP || error == ENOTTY || error == EBADF;
+}
+
+/**
+ * Copy the first size bytes without passing them through user space:
+ * reflink first, then copy_file_range, then sendfile
+ * @return bytes copied; the caller copies any remainder itself
+ */
+size_t kernel_copy(int in, int out, size_t size) {
+    // A reflink shares the source extents (btrfs, XFS): no data moves.
+    // It clones the whole file, so only when that is what was asked for
+    struct stat st;
+    if (fstat(in, &st) == 0 && static_cast<size_t>(st.st_size) == size &&
+        ioctl(out, FICLONE, in) == 0) {
+        return size;
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        loff_t in_offset = done;
+        loff_t out_offset = done;
+        const ssize_t n = copy_file_range(in, &in_offset, out, &out_offset, size - done, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (unsupported(errno)) break;
+            throw std::runtime_error(std::string("Error copying file - ") + std::strerror(errno));
+        }
+        if (n == 0) {
+            throw std::runtime_error("Unexpected end of file");
+        }
+        done += static_cast<size_t>(n);
+    }
+
+    // sendfile writes at the output's file position
+    if (done < size && lseek(out, static_cast<off_t>(done), SEEK_SET) >= 0) {
+        while (done < size) {
+            off_t offset = static_cast<off_t>(done);
+            const ssize_t n = sendfile(out, in, &offset, size - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (unsupported(errno)) break;
+                throw std::runtime_error(std::string("Error copying file - ") + std::strerror(errno));
+            }
+            if (n == 0) {
+                throw std::runtime_error("Unexpected end of file");
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+    return done;
+}
+#endif
+
+} // namespace
+
 size_t FileOperations::get_file_size(const std::string& filepath) {
 #ifndef _WIN32
     struct stat st;
@@ -42,6 +112,18 @@ bool FileOperations::file_exists(const std::string& filepath) {
 #endif
 }
 
+bool FileOperations::is_stream(const std::string& filepath) {
+    if (filepath == IOFile::kStandardStream) {
+        return true;
+    }
+#ifndef _WIN32
+    struct stat st;
+    return stat(filepath.c_str(), &st) == 0 && !S_ISREG(st.st_mode);
+#else
+    return filepath.rfind("\\\\.\\pipe\\", 0) == 0;
+#endif
+}
+
 bool FileOperations::is_same_file(
     const std::string& path1,
     const std::string& path2
@@ -66,38 +148,51 @@ void FileOperations::copy_file(
     const std::string& dst,
     size_t size
 ) {
-    std::ifstream in(src, std::ios::binary);
-    if (!in) {
-        throw std::runtime_error("Cannot open source file: " + src);
-    }
-    
-    std::ofstream out(dst, std::ios::binary);
-    if (!out) {
-        throw std::runtime_error("Cannot create destination file: " + dst);
+    IOFile in(src, IOFile::Mode::Read);
+    IOFile out(dst, IOFile::Mode::Write);
+
+    size_t start = 0;
+#ifdef __linux__
+    start = kernel_copy(static_cast<int>(in.native_handle()), static_cast<int>(out.native_handle()), size);
+#endif
+    if (start == size) return;
+
+    // Whatever the kernel could not copy goes through user space. Blocks
+    // cycle through a ring of buffers: a block is written as soon as its
+    // read completes, and its buffer is refilled once that write is done,
+    // so reads and writes of different blocks overlap
+    constexpr size_t kBuffers = 4;
+    constexpr size_t kBlockBytes = 4 * AsyncIO::kChunkBytes;
+    const size_t blocks = (size - start + kBlockBytes - 1) / kBlockBytes;
+
+    std::vector<IOBuffer> buffers;
+    auto io = AsyncIO::create();  // Destroyed first: drains before buffers go
+    std::vector<uint64_t> reads(kBuffers, 0);
+    std::vector<uint64_t> writes(kBuffers, 0);
+    const auto block_offset = [&](size_t block) {
+        return start + block * kBlockBytes;
+    };
+    const auto block_size = [&](size_t block) {
+        return std::min(kBlockBytes, size - block_offset(block));
+    };
+
+    for (size_t b = 0; b < std::min(kBuffers, blocks); ++b) {
+        buffers.emplace_back(kBlockBytes);
+        reads[b] = io->read(in, buffers[b].data(), block_size(b), block_offset(b));
     }
-    
-    // Copy in chunks
-    const size_t chunk_size = 1024 * 1024;  // 1 MB
-    std::vector<char> buffer(chunk_size);
-    
-    size_t remaining = size;
-    while (remaining > 0) {
-        size_t to_read = std::min(chunk_size, remaining);
-        in.read(buffer.data(), to_read);
-        
-        if (!in && !in.eof()) {
-            throw std::runtime_error("Error reading from source file");
-        }
-        
-        size_t actually_read = in.gcount();
-        out.write(buffer.data(), actually_read);
-        
-        if (!out) {
-            throw std::runtime_error("Error writing to destination file");
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const size_t slot = b % kBuffers;
+        io->wait(reads[slot]);
+        writes[slot] = io->write(out, buffers[slot].data(), block_size(b), block_offset(b));
+
+        const size_t next = b + kBuffers;
+        if (next < blocks) {
+            io->wait(writes[slot]);
+            reads[slot] = io->read(in, buffers[slot].data(), block_size(next), block_offset(next));
         }
-        
-        remaining -= actually_read;
     }
+    io->wait_all();
 }
 
 size_t FileOperations::validate_record_alignment(
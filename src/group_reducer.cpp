@@ -0,0 +1,69 @@
+#include "group_reducer.hpp"
+#include <cstring>
+#include <stdexcept>
+
+namespace binsort {
+
+GroupReducer::GroupReducer(size_t record_length, Comparator compare, const Config& config)
+    : record_length_(record_length)
+    , compare_(compare)
+    , config_(config)
+    , kept_(record_length) {
+    if (config_.count_length > 8 || config_.count_offset + config_.count_length > record_length) {
+        throw std::invalid_argument("Count field does not fit in the record");
+    }
+}
+
+bool GroupReducer::add(const uint8_t* record, uint8_t* out) {
+    if (group_size_ > 0 && compare_(record, kept_.data()) == 0) {
+        group_size_++;
+        if (config_.duplicates == DuplicateMode::KeepLast) {
+            std::memcpy(kept_.data(), record, record_length_);
+        }
+        return false;
+    }
+    if (!config_.active()) {
+        std::memmove(out, record, record_length_);
+        return true;
+    }
+
+    // In place, a finished group is written to a slot behind record
+    const bool emitted = finish(out);
+    std::memcpy(kept_.data(), record, record_length_);
+    group_size_ = 1;
+    return emitted;
+}
+
+bool GroupReducer::finish(uint8_t* out) {
+    if (group_size_ == 0) return false;
+    std::memcpy(out, kept_.data(), record_length_);
+    store_count(out);
+    group_size_ = 0;
+    return true;
+}
+
+size_t GroupReducer::reduce(uint8_t* data, size_t record_count) {
+    if (!config_.active()) return record_count;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < record_count; ++i) {
+        if (add(data + i * record_length_, data + kept * record_length_)) kept++;
+    }
+    if (finish(data + kept * record_length_)) kept++;
+    return kept;
+}
+
+void GroupReducer::store_count(uint8_t* record) const {
+    const size_t length = config_.count_length;
+    if (length == 0) return;
+
+    const uint64_t max = (length == 8) ? ~uint64_t(0) : (uint64_t(1) << (8 * length)) - 1;
+    const uint64_t value = (group_size_ < max) ? group_size_ : max;
+    uint8_t* field = record + config_.count_offset;
+    for (size_t i = 0; i < length; ++i) {
+        const uint8_t byte = static_cast<uint8_t>(value >> (8 * i));
+        field[config_.count_big_endian ? length - 1 - i : i] = byte;
+    }
+}
+
+} // namespace binsort
@@ -0,0 +1,35 @@
+// Radix histogram kernels, compiled once per instruction set level
+//
+// Each of simd_kernels.cpp (baseline), simd_kernels_avx2.cpp and
+// simd_kernels_avx512.cpp includes this file inside its own namespace,
+// so the same loops are built for x86-64-v2, v3 and v4. Plain loops,
+// fixed-size arrays and memcpy only: see simd_isa.hpp.
+
+void count_bytes(const uint8_t* bytes, size_t stride, size_t count, uint8_t mask, size_t* histogram) {
+    // Four sub-histograms keep runs of equal bytes from serializing on
+    // one counter
+    size_t partial[4][256] = {};
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, bytes += 4 * stride) {
+        partial[0][bytes[0]]++;
+        partial[1][bytes[stride]]++;
+        partial[2][bytes[2 * stride]]++;
+        partial[3][bytes[3 * stride]]++;
+    }
+    for (; i < count; ++i, bytes += stride) {
+        partial[0][bytes[0]]++;
+    }
+    for (size_t b = 0; b < 256; ++b) {
+        histogram[b ^ mask] += partial[0][b] + partial[1][b] + partial[2][b] + partial[3][b];
+    }
+}
+
+void count_key_bytes(const uint8_t* items, size_t item_size, size_t count, size_t* histograms) {
+    for (size_t i = 0; i < count; ++i, items += item_size) {
+        uint64_t key;
+        memcpy(&key, items, sizeof(key));
+        for (size_t d = 0; d < 8; ++d) {
+            histograms[256 * d + ((key >> (8 * d)) & 0xff)]++;
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#include "index_sort.hpp"
+#include "simd_kernels.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace binsort {
+
+KeyIndexSort::KeyIndexSort(
+    size_t record_length,
+    const std::vector<KeySpec>& keys,
+    ThreadPool& pool
+) : record_length_(record_length)
+  , normalizer_(keys)
+  , pool_(pool)
+  , tail_width_(normalizer_.prefix_is_exact() ? 0 : normalizer_.key_width() - 8) {}
+
+bool KeyIndexSort::less(const Entry& a, const Entry& b) const {
+    if (a.prefix != b.prefix) return a.prefix < b.prefix;
+    if (tail_width_ > 0) {
+        const int cmp = std::memcmp(
+            tails_.data() + a.index * tail_width_,
+            tails_.data() + b.index * tail_width_,
+            tail_width_
+        );
+        if (cmp != 0) return cmp < 0;
+    }
+    return a.index < b.index;
+}
+
+void KeyIndexSort::build_entries(const uint8_t* data, Entries& entries) {
+    const size_t count = entries.size();
+    const size_t tasks = std::max<size_t>(1, std::min(pool_.size(), count / 4096));
+    const size_t per_task = (count + tasks - 1) / tasks;
+
+    if (tail_width_ > 0) {
+        tails_.resize(count * tail_width_);
+    }
+
+    const PrefixGather gather(normalizer_);
+    pool_.parallel_for(tasks, [&](size_t t) {
+        const size_t begin = std::min(count, t * per_task);
+        const size_t end = std::min(count, begin + per_task);
+        gather.build(data, record_length_, count, begin, end, entries.data() + begin);
+        if (tail_width_ == 0) return;
+
+        std::vector<uint8_t> key(normalizer_.key_width());
+        for (size_t i = begin; i < end; ++i) {
+            normalizer_.normalize(data + i * record_length_, key.data());
+            std::memcpy(tails_.data() + i * tail_width_, key.data() + 8, tail_width_);
+        }
+    });
+}
+
+void KeyIndexSort::sort_entries(Entries& entries) const {
+    auto cmp = [this](const Entry& a, const Entry& b) { return less(a, b); };
+    // Exact prefixes order entries by (prefix, index) alone, which the
+    // vector kernels handle
+    auto sort_run = [&](size_t begin, size_t end) {
+        if (tail_width_ == 0) {
+            sort_entries_by_prefix(entries.data() + begin, end - begin);
+        } else {
+            std::sort(entries.begin() + begin, entries.begin() + end, cmp);
+        }
+    };
+    const size_t count = entries.size();
+    const size_t threads = pool_.size();
+
+    if (threads == 1 || count < kParallelMinEntries) {
+        sort_run(0, count);
+        return;
+    }
+
+    // Sort one run per thread, then merge runs pairwise in parallel
+    const size_t run = (count + threads - 1) / threads;
+    const size_t runs = (count + run - 1) / run;
+    pool_.parallel_for(runs, [&](size_t r) {
+        const size_t begin = r * run;
+        const size_t end = std::min(count, begin + run);
+        sort_run(begin, end);
+    });
+
+    Entries buffer(count);
+    Entries* src = &entries;
+    Entries* dst = &buffer;
+
+    for (size_t width = run; width < count; width *= 2) {
+        const size_t pairs = (count + 2 * width - 1) / (2 * width);
+        pool_.parallel_for(pairs, [&](size_t p) {
+            const size_t begin = p * 2 * width;
+            const size_t mid = std::min(count, begin + width);
+            const size_t end = std::min(count, begin + 2 * width);
+            std::merge(src->begin() + begin, src->begin() + mid,
+                       src->begin() + mid, src->begin() + end,
+                       dst->begin() + begin, cmp);
+        });
+        std::swap(src, dst);
+    }
+
+    if (src != &entries) {
+        entries.swap(buffer);
+    }
+}
+
+void KeyIndexSort::permute(uint8_t* data, size_t record_length, Entries& entries) {
+    // entries[i].index is the input position of the record that belongs at
+    // position i. Walk each cycle once, marking placed slots by pointing
+    // them at themselves.
+    std::vector<uint8_t> temp(record_length);
+    const size_t count = entries.size();
+
+    for (size_t start = 0; start < count; ++start) {
+        if (entries[start].index == start) continue;
+
+        std::memcpy(temp.data(), data + start * record_length, record_length);
+        size_t hole = start;
+        while (true) {
+            const size_t source = entries[hole].index;
+            entries[hole].index = hole;
+            if (source == start) {
+                std::memcpy(data + hole * record_length, temp.data(), record_length);
+                break;
+            }
+            std::memcpy(data + hole * record_length, data + source * record_length, record_length);
+            hole = source;
+        }
+    }
+}
+
+void KeyIndexSort::gather(
+    const uint8_t* input,
+    uint8_t* output,
+    size_t record_length,
+    const Entries& entries,
+    ThreadPool& pool
+) {
+    const size_t count = entries.size();
+    const size_t tasks = std::max<size_t>(1, std::min(pool.size(), count / 4096));
+    const size_t per_task = (count + tasks - 1) / tasks;
+
+    pool.parallel_for(tasks, [&](size_t t) {
+        const size_t begin = std::min(count, t * per_task);
+        const size_t end = std::min(count, begin + per_task);
+        for (size_t i = begin; i < end; ++i) {
+            std::memcpy(output + i * record_length, input + entries[i].index * record_length, record_length);
+        }
+    });
+}
+
+void KeyIndexSort::sort(uint8_t* data, size_t record_count) {
+    if (record_count <= 1 || normalizer_.key_width() == 0) return;
+
+    Entries entries(record_count);
+    build_entries(data, entries);
+    sort_entries(entries);
+    permute(data, record_length_, entries);
+    tails_.clear();
+}
+
+void KeyIndexSort::sort(const uint8_t* input, uint8_t* output, size_t record_count) {
+    if (record_count <= 1 || normalizer_.key_width() == 0) {
+        std::memcpy(output, input, record_count * record_length_);
+        return;
+    }
+
+    Entries entries(record_count);
+    build_entries(input, entries);
+    sort_entries(entries);
+    gather(input, output, record_length_, entries, pool_);
+    tails_.clear();
+}
+
+} // namespace binsort
@@ -0,0 +1,155 @@
+#include "key_normalizer.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace binsort {
+
+namespace {
+
+uint64_t load_le(const uint8_t* ptr, size_t length) {
+    uint64_t value = 0;
+    for (size_t i = length; i-- > 0;) {
+        value = (value << 8) | ptr[i];
+    }
+    return value;
+}
+
+void store_be(uint8_t* out, uint64_t value, size_t length) {
+    for (size_t i = length; i-- > 0;) {
+        out[i] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+template <size_t N>
+void normalize_little_int(const uint8_t* src, uint8_t* dst) {
+    for (size_t i = 0; i < N; ++i) {
+        dst[i] = src[N - 1 - i];
+    }
+    dst[0] ^= 0x80;
+}
+
+} // namespace
+
+KeyNormalizer::KeyNormalizer(const std::vector<KeySpec>& keys) {
+    steps_.reserve(keys.size());
+
+    for (const auto& key : keys) {
+        if (key.position == 0) {
+            throw std::invalid_argument("Key position must be >= 1 (1-based)");
+        }
+
+        Kind kind = Kind::Bytes;
+        switch (key.type) {
+            case KeyType::Character:         kind = Kind::Bytes; break;
+            case KeyType::LittleEndianInt:   kind = Kind::LittleInt; break;
+            case KeyType::BigEndianInt:      kind = Kind::BigInt; break;
+            case KeyType::LittleEndianFloat: kind = Kind::LittleFloat; break;
+        }
+        if (kind != Kind::Bytes && key.length != 2 && key.length != 4 && key.length != 8) {
+            throw std::invalid_argument("Numeric key length must be 2, 4, or 8 bytes");
+        }
+
+        steps_.push_back({
+            key.offset(),
+            key_width_,
+            key.length,
+            kind,
+            key.order == SortOrder::Descending
+        });
+        key_width_ += key.length;
+    }
+}
+
+void KeyNormalizer::normalize_until(const uint8_t* record, uint8_t* out, size_t limit) const {
+    for (const Step& step : steps_) {
+        if (step.dst_offset >= limit) break;
+
+        const uint8_t* src = record + step.src_offset;
+        uint8_t* dst = out + step.dst_offset;
+        size_t length = step.length;
+
+        switch (step.kind) {
+            case Kind::Bytes:
+                length = std::min(length, limit - step.dst_offset);
+                std::memcpy(dst, src, length);
+                break;
+
+            case Kind::LittleInt:
+                switch (length) {
+                    case 2: normalize_little_int<2>(src, dst); break;
+                    case 4: normalize_little_int<4>(src, dst); break;
+                    case 8: normalize_little_int<8>(src, dst); break;
+                }
+                break;
+
+            case Kind::BigInt:
+                std::memcpy(dst, src, length);
+                dst[0] ^= 0x80;
+                break;
+
+            case Kind::LittleFloat: {
+                const uint64_t sign = uint64_t(1) << (length * 8 - 1);
+                const uint64_t mask = (length == 8) ? ~uint64_t(0) : (sign << 1) - 1;
+                uint64_t bits = load_le(src, length);
+                bits = (bits & sign) ? (~bits & mask) : (bits | sign);
+                store_be(dst, bits, length);
+                break;
+            }
+        }
+
+        if (step.descending) {
+            for (size_t i = 0; i < length; ++i) {
+                dst[i] = static_cast<uint8_t>(~dst[i]);
+            }
+        }
+    }
+}
+
+bool KeyNormalizer::byte_source(size_t position, size_t& offset, uint8_t& mask) const {
+    for (const Step& step : steps_) {
+        if (position < step.dst_offset || position >= step.dst_offset + step.length) {
+            continue;
+        }
+
+        const size_t index = position - step.dst_offset;
+        mask = step.descending ? 0xff : 0x00;
+        switch (step.kind) {
+            case Kind::Bytes:
+                offset = step.src_offset + index;
+                return true;
+            case Kind::LittleInt:
+                offset = step.src_offset + step.length - 1 - index;
+                if (index == 0) mask ^= 0x80;
+                return true;
+            case Kind::BigInt:
+                offset = step.src_offset + index;
+                if (index == 0) mask ^= 0x80;
+                return true;
+            case Kind::LittleFloat:
+                return false;
+        }
+    }
+    return false;
+}
+
+void KeyNormalizer::normalize(const uint8_t* record, uint8_t* out) const {
+    normalize_until(record, out, key_width_);
+}
+
+uint64_t KeyNormalizer::prefix(const uint8_t* record) const {
+    // Room for a numeric key starting at byte 7
+    uint8_t buffer[16] = {};
+    normalize_until(record, buffer, 8);
+
+    uint64_t value;
+    std::memcpy(&value, buffer, sizeof(value));
+    if constexpr (std::endian::native == std::endian::little) {
+        value = __builtin_bswap64(value);
+    }
+    return value;
+}
+
+} // namespace binsort
@@ -0,0 +1,61 @@
+#include "loser_tree.hpp"
+#include <stdexcept>
+#include <utility>
+
+namespace binsort {
+
+LoserTree::LoserTree(size_t source_count, Comparator compare)
+    : k_(source_count)
+    , compare_(compare)
+    , heads_(source_count, nullptr)
+    , tree_(source_count, 0) {
+    if (source_count == 0) {
+        throw std::invalid_argument("Loser tree needs at least one source");
+    }
+}
+
+bool LoserTree::beats(size_t a, size_t b) const {
+    const uint8_t* ha = heads_[a];
+    const uint8_t* hb = heads_[b];
+    if (ha == nullptr) return false;
+    if (hb == nullptr) return true;
+
+    const int cmp = compare_(ha, hb);
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+size_t LoserTree::build(size_t node) {
+    // Nodes k..2k-1 are the leaves (sources 0..k-1)
+    if (node >= k_) return node - k_;
+
+    const size_t left = build(2 * node);
+    const size_t right = build(2 * node + 1);
+    if (beats(left, right)) {
+        tree_[node] = right;
+        return left;
+    }
+    tree_[node] = left;
+    return right;
+}
+
+void LoserTree::reset(const std::vector<const uint8_t*>& heads) {
+    if (heads.size() != k_) {
+        throw std::invalid_argument("Loser tree source count mismatch");
+    }
+    heads_ = heads;
+    tree_[0] = (k_ == 1) ? 0 : build(1);
+}
+
+void LoserTree::replace_winner(const uint8_t* next) {
+    size_t winner = tree_[0];
+    heads_[winner] = next;
+
+    for (size_t node = (winner + k_) / 2; node > 0; node /= 2) {
+        if (beats(tree_[node], winner)) {
+            std::swap(tree_[node], winner);
+        }
+    }
+    tree_[0] = winner;
+}
+
+} // namespace binsort
@@ -1,97 +1,333 @@
 #include "argument_parser.hpp"
+#include "async_io.hpp"
+#include "external_sort.hpp"
 #include "file_operations.hpp"
+#include "group_reducer.hpp"
 #include "memory_mapper.hpp"
+#include "memory_placement.hpp"
+#include "simd_kernels.hpp"
 #include "sort_engine.hpp"
+#include "top_k.hpp"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <memory>
 
 using namespace binsort;
 
+namespace {
+
+// Read a pipe or other stream to its end in large blocks
+PlacedVector<uint8_t> read_stream(const std::string& path, size_t record_length) {
+    constexpr size_t kBlockBytes = 8 * 1024 * 1024;
+    IOFile in(path, IOFile::Mode::Read);
+    PlacedVector<uint8_t> data;
+    size_t size = 0;
+    while (true) {
+        data.resize(size + kBlockBytes);
+        const size_t n = in.read_next(data.data() + size, kBlockBytes);
+        size += n;
+        if (n < kBlockBytes) break;
+    }
+    data.resize(size);
+
+    if (size % record_length != 0) {
+        throw std::runtime_error(
+            "Input size (" + std::to_string(size) +
+            ") is not divisible by record length (" +
+            std::to_string(record_length) + ")"
+        );
+    }
+    return data;
+}
+
+SortEngine::Config engine_config(const ArgumentParser::Arguments& args) {
+    SortEngine::Config config;
+    config.record_length = args.record_length;
+    config.thread_count = args.thread_count;
+    config.keys = args.keys;
+    config.algorithm = args.algorithm;
+    // First and last of a group mean input order only if sorted stably
+    config.stable = args.stable || args.groups.active();
+    return config;
+}
+
+ExternalSort::Config external_config(const ArgumentParser::Arguments& args) {
+    ExternalSort::Config config;
+    config.record_length = args.record_length;
+    config.memory_budget = args.memory_budget;
+    config.temp_directory = args.temp_directory;
+    config.direct_io = args.direct_io;
+    config.groups = args.groups;
+    return config;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
     try {
         // Parse arguments
         auto args = ArgumentParser::parse(argc, argv);
+        MemoryPlacement::set_explicit_huge_pages(args.explicit_huge_pages);
+
+        // Sorted records may be going to stdout; keep progress off it
+        std::ostream& log = (args.output_file == IOFile::kStandardStream) ? std::cerr : std::cout;
         
-        std::cout << "Binary Sort Utility\n";
-        std::cout << "===================\n";
-        std::cout << "Input:        " << args.input_file << "\n";
-        std::cout << "Output:       " << args.output_file << "\n";
-        std::cout << "Record size:  " << args.record_length << " bytes\n";
-        std::cout << "Keys:         " << args.keys.size() << "\n";
-        std::cout << "Threads:      " << args.thread_count << "\n";
-        
-        // Validate input file
-        if (!FileOperations::file_exists(args.input_file)) {
-            throw std::runtime_error("Input file does not exist: " + args.input_file);
+        log << "Binary Sort Utility\n";
+        log << "===================\n";
+        for (const auto& input : args.input_files) {
+            log << "Input:        " << input << "\n";
         }
+        log << "Output:       " << args.output_file << "\n";
+        log << "Record size:  " << args.record_length << " bytes\n";
+        log << "Keys:         " << args.keys.size() << "\n";
+        log << "Threads:      " << args.thread_count << "\n";
+        log << "SIMD:         " << simd_level_name(detected_simd_level()) << "\n";
         
-        // Validate record alignment
-        size_t record_count = FileOperations::validate_record_alignment(
-            args.input_file,
-            args.record_length
-        );
-        
-        std::cout << "Records:      " << record_count << "\n";
-        std::cout << "\n";
-        
-        // Check if in-place sorting
-        bool in_place = FileOperations::is_same_file(args.input_file, args.output_file);
-        
-        std::string sort_file = args.output_file;
-        
-        if (!in_place) {
-            // Copy input to output first
-            std::cout << "Copying input to output...\n";
+        // Sorted inputs are merged in one sequential pass, in a single
+        // merge as long as every input gets a large read buffer
+        if (args.merge) {
+            constexpr size_t kMergeBufferBytes = 16 * 1024 * 1024;
+            log << "\nMerging " << args.input_files.size() << " sorted inputs...\n";
             auto start = std::chrono::high_resolution_clock::now();
-            
-            size_t file_size = FileOperations::get_file_size(args.input_file);
-            FileOperations::copy_file(args.input_file, args.output_file, file_size);
-            
+
+            SortEngine engine(engine_config(args));
+            ExternalSort::Config config = external_config(args);
+            if (config.memory_budget == 0) {
+                config.memory_budget = (args.input_files.size() + 1) * kMergeBufferBytes;
+            }
+            ExternalSort merger(config, engine);
+            auto stats = merger.merge(args.input_files, args.output_file);
+
             auto end = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            std::cout << "Copy completed in " << duration.count() << " ms\n\n";
+            log << "Merged " << stats.output_records << " records in " << stats.merge_passes
+                      << " passes in " << duration.count() << " ms\n";
+            log << "Done!\n";
+            return 0;
+        }
+
+        // Pipes and "-" are read and written sequentially; they cannot be
+        // stat'ed for a size or mapped
+        const bool streaming = FileOperations::is_stream(args.input_file) ||
+                               FileOperations::is_stream(args.output_file);
+
+        size_t record_count = 0;
+        size_t file_size = 0;
+        bool in_place = false;
+        if (!streaming) {
+            // Validate input file
+            if (!FileOperations::file_exists(args.input_file)) {
+                throw std::runtime_error("Input file does not exist: " + args.input_file);
+            }
+
+            // Validate record alignment
+            record_count = FileOperations::validate_record_alignment(
+                args.input_file,
+                args.record_length
+            );
+
+            log << "Records:      " << record_count << "\n";
+            log << "\n";
+
+            // Check if in-place sorting
+            in_place = FileOperations::is_same_file(args.input_file, args.output_file);
+
+            if (in_place) {
+                log << "In-place sorting detected\n\n";
+            }
+
+            file_size = FileOperations::get_file_size(args.input_file);
+
+            if (record_count == 0 || (record_count == 1 && args.groups.count_length == 0)) {
+                // Already sorted; the output is a copy, which the kernel can
+                // make without reading the data
+                if (!in_place) {
+                    FileOperations::copy_file(args.input_file, args.output_file, file_size);
+                }
+                log << "Done!\n";
+                return 0;
+            }
         } else {
-            std::cout << "In-place sorting detected\n\n";
+            log << "Streaming input/output\n\n";
         }
-        
-        // Map the file for sorting (read-write mode)
-        std::cout << "Mapping file into memory...\n";
-        MemoryMapper mapper(sort_file, MemoryMapper::Mode::ReadWrite);
-        
-        std::cout << "Mapped " << mapper.size() << " bytes\n\n";
-        
+
         // Create sort engine
-        SortEngine::Config config;
-        config.record_length = args.record_length;
-        config.thread_count = args.thread_count;
-        config.keys = args.keys;
+        SortEngine engine(engine_config(args));
+        GroupReducer groups(args.record_length, engine.get_comparator(), args.groups);
+        
+        // A top-K selection holds only limit records whatever the input
+        // size, so it needs neither the memory budget nor spilled runs
+        if (args.limit > 0) {
+            log << "Selecting the first " << args.limit << " records...\n";
+            auto start = std::chrono::high_resolution_clock::now();
+
+            TopK top(args.record_length, args.limit, engine);
+            auto stats = top.select(args.input_file, args.output_file);
+
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            log << "Selected " << stats.selected << " of " << stats.records
+                      << " records in " << duration.count() << " ms\n";
+            log << "Done!\n";
+            return 0;
+        }
+
+        // Sorted input needs only a copy, which a reflink makes without
+        // moving data; unsorted input stops the scan at its first descent
+        if (!streaming && !in_place && !args.direct_io && !args.groups.active()) {
+            bool sorted = false;
+            {
+                MemoryMapper input(args.input_file, MemoryMapper::Mode::ReadOnly);
+                input.advise(MemoryPlacement::Access::Sequential);
+                sorted = engine.is_sorted(static_cast<const uint8_t*>(input.data()), record_count);
+            }
+            if (sorted) {
+                log << "Input already sorted; copying\n";
+                FileOperations::copy_file(args.input_file, args.output_file, file_size);
+                log << "Done!\n";
+                return 0;
+            }
+        }
+
+        // Inputs over the memory budget are sorted out of core; a stream
+        // of unknown length goes through the external sort whenever there
+        // is a budget, which keeps it in memory if it fits in one run
+        if (args.memory_budget > 0 && (streaming || file_size > args.memory_budget)) {
+            log << "External sort with " << args.memory_budget << " byte budget...\n";
+            auto start = std::chrono::high_resolution_clock::now();
+
+            ExternalSort external(external_config(args), engine);
+            auto stats = external.sort(args.input_file, args.output_file);
+
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            log << "Sorted " << stats.runs << " runs in " << stats.merge_passes
+                      << " merge passes in " << duration.count() << " ms\n";
+            if (args.groups.active()) {
+                log << "Kept " << stats.output_records << " records\n";
+            }
+            log << "Done!\n";
+            return 0;
+        }
+
+        if (streaming) {
+            log << "Reading input...\n";
+            PlacedVector<uint8_t> data = read_stream(args.input_file, args.record_length);
+            record_count = data.size() / args.record_length;
+            log << "Records:      " << record_count << "\n";
+
+            log << "Sorting...\n";
+            auto start = std::chrono::high_resolution_clock::now();
+            engine.sort(data.data(), record_count);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            log << "Sort completed in " << duration.count() << " ms\n";
+
+            const size_t kept = groups.reduce(data.data(), record_count);
+            IOFile out(args.output_file, IOFile::Mode::Write);
+            out.write_next(data.data(), kept * args.record_length);
+            log << "Done!\n";
+            return 0;
+        }
+
+        // Direct I/O reads the whole file into one aligned buffer, sorts it
+        // in place there and writes it back, leaving the page cache alone
+        if (args.direct_io) {
+            log << "Reading file with direct I/O...\n";
+            IOBuffer buffer(file_size);
+            auto io = AsyncIO::create();
+            {
+                IOFile in(args.input_file, IOFile::Mode::Read, true);
+                io->wait(io->read(in, buffer.data(), file_size, 0));
+            }
+
+            log << "Sorting...\n";
+            auto start = std::chrono::high_resolution_clock::now();
+            engine.sort(buffer.data(), record_count);
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            log << "Sort completed in " << duration.count() << " ms\n";
+
+            const size_t kept = groups.reduce(buffer.data(), record_count);
+
+            log << "Writing file with direct I/O...\n";
+            {
+                IOFile out(args.output_file, IOFile::Mode::Write, true);
+                io->wait(io->write(out, buffer.data(), kept * args.record_length, 0));
+            }
+            log << "Done!\n";
+            return 0;
+        }
+
+        // In-place sorts map the file read-write. Otherwise the input is
+        // mapped copy-on-write and used as scratch, and sorted records are
+        // written straight into the output: no separate copy pass.
+        log << "Mapping file into memory...\n";
+        std::unique_ptr<MemoryMapper> input_mapper;
+        if (!in_place) {
+            FileOperations::create_file(args.output_file, file_size);
+            input_mapper = std::make_unique<MemoryMapper>(args.input_file, MemoryMapper::Mode::CopyOnWrite);
+        }
+        MemoryMapper mapper(args.output_file, MemoryMapper::Mode::ReadWrite);
         
-        SortEngine engine(config);
+        log << "Mapped " << mapper.size() << " bytes\n\n";
+
+        // Every page of the input is read by the first pass of any sort
+        // algorithm; start reading it all in now rather than fault by fault
+        if (input_mapper) {
+            input_mapper->advise(MemoryPlacement::Access::WillNeed);
+        } else {
+            mapper.advise(MemoryPlacement::Access::WillNeed);
+        }
         
         // Perform sort
-        std::cout << "Sorting...\n";
+        log << "Sorting...\n";
         auto start = std::chrono::high_resolution_clock::now();
         
-        engine.sort(static_cast<uint8_t*>(mapper.data()), record_count);
+        if (input_mapper) {
+            engine.sort(
+                static_cast<uint8_t*>(input_mapper->data()),
+                static_cast<uint8_t*>(mapper.data()),
+                record_count
+            );
+        } else {
+            engine.sort(static_cast<uint8_t*>(mapper.data()), record_count);
+        }
         
         auto end = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
         
-        std::cout << "Sort completed in " << duration.count() << " ms\n";
+        log << "Sort completed in " << duration.count() << " ms\n";
         
         // Calculate throughput
         double seconds = duration.count() / 1000.0;
         double mb_per_sec = (mapper.size() / (1024.0 * 1024.0)) / seconds;
         
-        std::cout << "Throughput: " << std::fixed << std::setprecision(2) 
+        log << "Throughput: " << std::fixed << std::setprecision(2) 
                   << mb_per_sec << " MB/s\n\n";
         
+        // The copy-on-write scratch is spent; free it before writeback
+        if (input_mapper) {
+            input_mapper->advise(MemoryPlacement::Access::DontNeed);
+        }
+
+        // Dropped duplicates are cut off the end of the file before their
+        // pages are ever written
+        const size_t kept = groups.reduce(static_cast<uint8_t*>(mapper.data()), record_count);
+        if (args.groups.active()) {
+            log << "Kept " << kept << " of " << record_count << " records\n";
+        }
+
         // Sync changes to disk
-        std::cout << "Syncing to disk...\n";
-        mapper.sync(false);
+        log << "Syncing to disk...\n";
+        if (kept < record_count) {
+            mapper.truncate(kept * args.record_length);
+        } else {
+            mapper.sync(false);
+        }
         
-        std::cout << "Done!\n";
+        log << "Done!\n";
         
         return 0;
     }
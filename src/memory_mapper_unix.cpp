@@ -64,8 +64,8 @@ void MemoryMapper::map_file(const std::string& filepath) {
     size_ = st.st_size;
 
     // Map the file
-    int prot = (mode_ == Mode::ReadWrite) ? (PROT_READ | PROT_WRITE) : PROT_READ;
-    int map_flags = MAP_SHARED;
+    int prot = (mode_ == Mode::ReadOnly) ? PROT_READ : (PROT_READ | PROT_WRITE);
+    int map_flags = (mode_ == Mode::CopyOnWrite) ? MAP_PRIVATE : MAP_SHARED;
     
     data_ = mmap(nullptr, size_, prot, map_flags, fd_, 0);
     
@@ -75,9 +75,6 @@ void MemoryMapper::map_file(const std::string& filepath) {
         throw std::runtime_error(std::string("Failed to map file: ") + 
                                  std::strerror(errno));
     }
-
-    // Advise kernel about access pattern (sequential)
-    madvise(data_, size_, MADV_SEQUENTIAL);
 }
 
 void MemoryMapper::unmap() {
@@ -104,6 +101,26 @@ void MemoryMapper::sync(bool async) {
     }
 }
 
+void MemoryMapper::truncate(size_t length) {
+    if (data_ == nullptr || mode_ != Mode::ReadWrite || length > size_) {
+        throw std::runtime_error("Cannot truncate this mapping");
+    }
+
+    if (length > 0 && msync(data_, length, MS_SYNC) == -1) {
+        throw std::runtime_error("Failed to sync memory map: " +
+                                 std::string(std::strerror(errno)));
+    }
+    munmap(data_, size_);
+    data_ = nullptr;
+
+    const int result = ftruncate(fd_, static_cast<off_t>(length));
+    const int error = errno;
+    unmap();
+    if (result == -1) {
+        throw std::runtime_error("Failed to truncate file: " + std::string(std::strerror(error)));
+    }
+}
+
 } // namespace binsort
 
 #endif // !_WIN32
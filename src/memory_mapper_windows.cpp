@@ -74,8 +74,8 @@ void MemoryMapper::map_file(const std::string& filepath) {
     size_ = static_cast<size_t>(file_size.QuadPart);
 
     // Create file mapping
-    DWORD protect = (mode_ == Mode::ReadWrite) ? 
-        PAGE_READWRITE : PAGE_READONLY;
+    DWORD protect = (mode_ == Mode::ReadWrite) ? PAGE_READWRITE :
+        (mode_ == Mode::CopyOnWrite) ? PAGE_WRITECOPY : PAGE_READONLY;
     
     map_handle_ = CreateFileMappingA(
         file_handle_,
@@ -92,8 +92,8 @@ void MemoryMapper::map_file(const std::string& filepath) {
     }
 
     // Map view of file
-    DWORD map_access = (mode_ == Mode::ReadWrite) ? 
-        FILE_MAP_WRITE : FILE_MAP_READ;
+    DWORD map_access = (mode_ == Mode::ReadWrite) ? FILE_MAP_WRITE :
+        (mode_ == Mode::CopyOnWrite) ? FILE_MAP_COPY : FILE_MAP_READ;
     
     data_ = MapViewOfFile(
         map_handle_,
@@ -140,6 +140,31 @@ void MemoryMapper::sync(bool async) {
     }
 }
 
+void MemoryMapper::truncate(size_t length) {
+    if (data_ == nullptr || mode_ != Mode::ReadWrite || length > size_) {
+        throw std::runtime_error("Cannot truncate this mapping");
+    }
+
+    if (length > 0 && !FlushViewOfFile(data_, length)) {
+        throw std::runtime_error("Failed to flush memory map");
+    }
+    // A mapped file cannot be shortened; drop the view and mapping first
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+    CloseHandle(map_handle_);
+    map_handle_ = nullptr;
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(length);
+    const bool ok = SetFilePointerEx(file_handle_, end, nullptr, FILE_BEGIN) &&
+                    SetEndOfFile(file_handle_) &&
+                    FlushFileBuffers(file_handle_);
+    unmap();
+    if (!ok) {
+        throw std::runtime_error("Failed to truncate file");
+    }
+}
+
 } // namespace binsort
 
 #endif // _WIN32
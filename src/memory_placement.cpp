@@ -0,0 +1,196 @@
+#include "memory_placement.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+#else
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace binsort {
+
+namespace {
+
+std::atomic<bool> explicit_huge_pages{false};
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+size_t heap_alignment(size_t alignment) {
+    return std::max<size_t>(alignment, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+#ifdef __linux__
+// Parse a sysfs list such as "0-3,8,10-11"
+std::vector<size_t> parse_list(const std::string& text) {
+    std::vector<size_t> values;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos) end = text.size();
+        const std::string range = text.substr(pos, end - pos);
+        const size_t dash = range.find('-');
+        try {
+            const size_t first = std::stoul(range.substr(0, dash));
+            const size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            for (size_t v = first; v <= last; ++v) values.push_back(v);
+        } catch (const std::exception&) {
+            return {};
+        }
+        pos = end + 1;
+    }
+    return values;
+}
+
+std::string read_line(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+struct Topology {
+    std::vector<size_t> nodes;  // Online node ids
+};
+
+const Topology& topology() {
+    static const Topology instance = []() {
+        Topology t;
+        t.nodes = parse_list(read_line("/sys/devices/system/node/online"));
+        return t;
+    }();
+    return instance;
+}
+
+// Spread the pages of a fresh mapping round-robin over every node
+void interleave(void* data, size_t bytes) {
+    const Topology& t = topology();
+    if (t.nodes.size() < 2) return;
+
+    constexpr size_t kMaskBits = 1024;
+    unsigned long mask[kMaskBits / (8 * sizeof(unsigned long))] = {};
+    const size_t bits_per_word = 8 * sizeof(unsigned long);
+    for (size_t node : t.nodes) {
+        if (node < kMaskBits) mask[node / bits_per_word] |= 1UL << (node % bits_per_word);
+    }
+    // Only a hint: memory still works if the policy is refused
+    syscall(SYS_mbind, data, bytes, MPOL_INTERLEAVE, mask, kMaskBits + 1, 0);
+}
+
+// Anonymous mapping of length bytes starting on a huge page boundary
+void* map_large(size_t length) {
+#ifdef MAP_HUGETLB
+    // Explicit huge pages exist only if the administrator reserved some,
+    // usually for another service, so they are only taken on request
+    if (explicit_huge_pages.load(std::memory_order_relaxed)) {
+        const int huge_2mb = 21 << MAP_HUGE_SHIFT;
+        void* huge = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_2mb, -1, 0);
+        if (huge != MAP_FAILED) return huge;
+    }
+#endif
+
+    // Over-map and trim so transparent huge pages can back the whole range
+    const size_t slack = MemoryPlacement::kHugePageBytes;
+    void* raw = mmap(nullptr, length + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+
+    const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t aligned = round_up(start, slack);
+    const size_t tail = start + slack - aligned;
+    if (aligned > start) munmap(raw, aligned - start);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + length), tail);
+
+    void* data = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    madvise(data, length, MADV_HUGEPAGE);
+#endif
+    return data;
+}
+#endif
+
+} // namespace
+
+void* MemoryPlacement::allocate(size_t bytes, size_t alignment) {
+    if (bytes < kLargeBytes || alignment > kHugePageBytes) {
+        return ::operator new(bytes, std::align_val_t(heap_alignment(alignment)));
+    }
+
+    const size_t length = round_up(bytes, kHugePageBytes);
+#if defined(__linux__)
+    void* data = map_large(length);
+    if (data == nullptr) throw std::bad_alloc();
+    interleave(data, length);
+#elif defined(_WIN32)
+    void* data = VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (data == nullptr) throw std::bad_alloc();
+#else
+    void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) throw std::bad_alloc();
+#endif
+    return data;
+}
+
+void MemoryPlacement::release(void* data, size_t bytes, size_t alignment) noexcept {
+    if (data == nullptr) return;
+    if (bytes < kLargeBytes || alignment > kHugePageBytes) {
+        ::operator delete(data, std::align_val_t(heap_alignment(alignment)));
+        return;
+    }
+#ifndef _WIN32
+    munmap(data, round_up(bytes, kHugePageBytes));
+#else
+    VirtualFree(data, 0, MEM_RELEASE);
+#endif
+}
+
+void MemoryPlacement::set_explicit_huge_pages(bool enabled) noexcept {
+    explicit_huge_pages.store(enabled, std::memory_order_relaxed);
+}
+
+void MemoryPlacement::advise(void* data, size_t bytes, Access access) noexcept {
+    if (data == nullptr || bytes == 0) return;
+#ifndef _WIN32
+    int advice = MADV_NORMAL;
+    switch (access) {
+        case Access::Normal: advice = MADV_NORMAL; break;
+        case Access::Sequential: advice = MADV_SEQUENTIAL; break;
+        case Access::Random: advice = MADV_RANDOM; break;
+        case Access::WillNeed: advice = MADV_WILLNEED; break;
+        case Access::DontNeed: advice = MADV_DONTNEED; break;
+    }
+    // madvise works on whole pages
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t start = reinterpret_cast<uintptr_t>(data) / page * page;
+    const uintptr_t end = reinterpret_cast<uintptr_t>(data) + bytes;
+    madvise(reinterpret_cast<void*>(start), end - start, advice);
+#else
+    if (access == Access::WillNeed) {
+        WIN32_MEMORY_RANGE_ENTRY range{data, bytes};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#endif
+}
+
+size_t MemoryPlacement::node_count() {
+#ifdef __linux__
+    return std::max<size_t>(1, topology().nodes.size());
+#else
+    return 1;
+#endif
+}
+
+} // namespace binsort
@@ -0,0 +1,300 @@
+#include "radix_sort.hpp"
+#include "index_sort.hpp"
+#include "memory_placement.hpp"
+#include "simd_kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+namespace binsort {
+
+namespace {
+
+using Histogram = std::array<size_t, 256>;
+
+constexpr size_t kDigits = 8;
+
+// All digits of a key, digit d at 256 * d
+using DigitHistograms = std::array<size_t, 256 * kDigits>;
+
+// Prefixes counted per block, small enough to stay in L1
+constexpr size_t kPrefixBlock = 256;
+
+/**
+ * Digit that is one item byte, possibly inverted
+ * Histograms of these go through the dispatched count_bytes() kernel.
+ */
+struct ByteDigit {
+    size_t offset;
+    uint8_t mask;
+
+    size_t operator()(const uint8_t* item) const { return item[offset] ^ mask; }
+};
+
+struct Slice {
+    size_t begin;
+    size_t end;
+};
+
+Slice slice_of(size_t count, size_t threads, size_t t) {
+    const size_t per_thread = (count + threads - 1) / threads;
+    const size_t begin = std::min(count, t * per_thread);
+    return {begin, std::min(count, begin + per_thread)};
+}
+
+/**
+ * One stable counting-sort pass over fixed-size items
+ */
+template <typename DigitFn>
+void radix_pass(
+    const uint8_t* src,
+    uint8_t* dst,
+    size_t item_size,
+    size_t count,
+    size_t threads,
+    ThreadPool& pool,
+    DigitFn digit
+) {
+    std::vector<Histogram> positions(threads);
+
+    pool.parallel_for(threads, [&](size_t t) {
+        Histogram& hist = positions[t];
+        hist.fill(0);
+        const Slice slice = slice_of(count, threads, t);
+        if constexpr (std::is_same_v<DigitFn, ByteDigit>) {
+            count_bytes(src + slice.begin * item_size + digit.offset, item_size,
+                        slice.end - slice.begin, digit.mask, hist.data());
+        } else {
+            for (size_t i = slice.begin; i < slice.end; ++i) {
+                hist[digit(src + i * item_size)]++;
+            }
+        }
+    });
+
+    // Bucket-major, thread-minor offsets keep the pass stable
+    size_t sum = 0;
+    for (size_t bucket = 0; bucket < 256; ++bucket) {
+        for (size_t t = 0; t < threads; ++t) {
+            const size_t n = positions[t][bucket];
+            positions[t][bucket] = sum;
+            sum += n;
+        }
+    }
+
+    const size_t per_bucket = std::max<size_t>(1, RadixSort::kWriteCombineBytes / item_size);
+
+    pool.parallel_for(threads, [&](size_t t) {
+        Histogram& pos = positions[t];
+        const Slice slice = slice_of(count, threads, t);
+
+        if (per_bucket == 1) {
+            for (size_t i = slice.begin; i < slice.end; ++i) {
+                const uint8_t* item = src + i * item_size;
+                std::memcpy(dst + pos[digit(item)]++ * item_size, item, item_size);
+            }
+            return;
+        }
+
+        // Software write-combining: gather items per bucket in a small
+        // cache-resident buffer and write them out in blocks
+        const size_t bucket_bytes = per_bucket * item_size;
+        std::vector<uint8_t> buffer(256 * bucket_bytes);
+        std::array<size_t, 256> fill{};
+
+        for (size_t i = slice.begin; i < slice.end; ++i) {
+            const uint8_t* item = src + i * item_size;
+            const size_t d = digit(item);
+            uint8_t* slot = buffer.data() + d * bucket_bytes;
+            std::memcpy(slot + fill[d] * item_size, item, item_size);
+            if (++fill[d] == per_bucket) {
+                std::memcpy(dst + pos[d] * item_size, slot, bucket_bytes);
+                pos[d] += per_bucket;
+                fill[d] = 0;
+            }
+        }
+
+        for (size_t d = 0; d < 256; ++d) {
+            if (fill[d] > 0) {
+                std::memcpy(dst + pos[d] * item_size, buffer.data() + d * bucket_bytes, fill[d] * item_size);
+            }
+        }
+    });
+}
+
+/**
+ * Count all 8 digits of every key in one parallel pass
+ * @param count_slice Adds the DigitHistograms of a slice of the keys
+ * @return true for each digit that has more than one distinct value
+ */
+template <typename CountFn>
+std::array<bool, kDigits> active_digits(
+    size_t count,
+    size_t threads,
+    ThreadPool& pool,
+    CountFn count_slice
+) {
+    std::vector<DigitHistograms> counts(threads);
+
+    pool.parallel_for(threads, [&](size_t t) {
+        counts[t].fill(0);
+        count_slice(slice_of(count, threads, t), counts[t].data());
+    });
+
+    std::array<bool, kDigits> active{};
+    for (size_t d = 0; d < kDigits; ++d) {
+        for (size_t bucket = 0; bucket < 256; ++bucket) {
+            size_t total = 0;
+            for (size_t t = 0; t < threads; ++t) total += counts[t][256 * d + bucket];
+            if (total == count) break;  // One value only: pass is a no-op
+            if (total > 0) {
+                active[d] = true;
+                break;
+            }
+        }
+    }
+    return active;
+}
+
+} // namespace
+
+RadixSort::RadixSort(
+    size_t record_length,
+    const std::vector<KeySpec>& keys,
+    ThreadPool& pool
+) : record_length_(record_length)
+  , normalizer_(keys)
+  , pool_(pool) {}
+
+bool RadixSort::supports(const std::vector<KeySpec>& keys) {
+    size_t width = 0;
+    for (const auto& key : keys) width += key.length;
+    return width > 0 && width <= 8;
+}
+
+void RadixSort::sort(uint8_t* data, size_t record_count) {
+    if (record_count <= 1) return;
+
+    if (record_length_ <= kDirectMaxRecordLength) {
+        sort_records(data, nullptr, record_count);
+    } else {
+        sort_pairs(data, nullptr, record_count);
+    }
+}
+
+void RadixSort::sort(uint8_t* input, uint8_t* output, size_t record_count) {
+    if (record_count <= 1) {
+        std::memcpy(output, input, record_count * record_length_);
+        return;
+    }
+
+    if (record_length_ <= kDirectMaxRecordLength) {
+        sort_records(input, output, record_count);
+    } else {
+        sort_pairs(input, output, record_count);
+    }
+}
+
+void RadixSort::sort_records(uint8_t* data, uint8_t* output, size_t record_count) {
+    const size_t threads = std::min(pool_.size(), std::max<size_t>(1, record_count / 4096));
+
+    const PrefixGather gather(normalizer_);
+    auto active = active_digits(record_count, threads, pool_, [&](Slice slice, size_t* histograms) {
+        std::array<KeyIndexSort::Entry, kPrefixBlock> block;
+        for (size_t begin = slice.begin; begin < slice.end; begin += kPrefixBlock) {
+            const size_t end = std::min(slice.end, begin + kPrefixBlock);
+            gather.build(data, record_length_, record_count, begin, end, block.data());
+            count_key_bytes(reinterpret_cast<const uint8_t*>(block.data()), sizeof(KeyIndexSort::Entry),
+                            end - begin, histograms);
+        }
+    });
+
+    PlacedVector<uint8_t> temp;
+    uint8_t* src = data;
+    uint8_t* dst = output;
+    if (output == nullptr) {
+        temp.resize(record_count * record_length_);
+        dst = temp.data();
+    } else if (std::count(active.begin(), active.end(), true) % 2 == 0) {
+        // An even number of passes ends where it started: start from the
+        // output so the last pass lands there
+        std::memcpy(output, data, record_count * record_length_);
+        std::swap(src, dst);
+    }
+
+    for (size_t d = 0; d < kDigits; ++d) {
+        if (!active[d]) continue;
+
+        // Prefix digit d is normalized key byte 7 - d
+        size_t offset = 0;
+        uint8_t mask = 0;
+        if (normalizer_.byte_source(7 - d, offset, mask)) {
+            radix_pass(src, dst, record_length_, record_count, threads, pool_, ByteDigit{offset, mask});
+        } else {
+            const unsigned shift = static_cast<unsigned>(d * 8);
+            radix_pass(src, dst, record_length_, record_count, threads, pool_,
+                [this, shift](const uint8_t* record) -> size_t {
+                    return (normalizer_.prefix(record) >> shift) & 0xff;
+                });
+        }
+        std::swap(src, dst);
+    }
+
+    if (output == nullptr && src != data) {
+        std::memcpy(data, src, record_count * record_length_);
+    }
+}
+
+void RadixSort::sort_pairs(uint8_t* data, uint8_t* output, size_t record_count) {
+    using Entry = KeyIndexSort::Entry;
+    const size_t threads = std::min(pool_.size(), std::max<size_t>(1, record_count / 4096));
+
+    KeyIndexSort::Entries entries(record_count);
+    const PrefixGather gather(normalizer_);
+    pool_.parallel_for(threads, [&](size_t t) {
+        const Slice slice = slice_of(record_count, threads, t);
+        gather.build(data, record_length_, record_count, slice.begin, slice.end,
+                     entries.data() + slice.begin);
+    });
+
+    const auto* items = reinterpret_cast<const uint8_t*>(entries.data());
+    auto active = active_digits(record_count, threads, pool_, [&](Slice slice, size_t* histograms) {
+        count_key_bytes(items + slice.begin * sizeof(Entry), sizeof(Entry), slice.end - slice.begin, histograms);
+    });
+
+    KeyIndexSort::Entries temp(record_count);
+    KeyIndexSort::Entries* src = &entries;
+    KeyIndexSort::Entries* dst = &temp;
+
+    for (size_t d = 0; d < kDigits; ++d) {
+        if (!active[d]) continue;
+
+        const auto pass = [&](auto digit) {
+            radix_pass(
+                reinterpret_cast<const uint8_t*>(src->data()),
+                reinterpret_cast<uint8_t*>(dst->data()),
+                sizeof(Entry), record_count, threads, pool_, digit);
+        };
+        if constexpr (std::endian::native == std::endian::little) {
+            // Digit d of the prefix is its byte d in memory
+            pass(ByteDigit{d, 0});
+        } else {
+            const unsigned shift = static_cast<unsigned>(d * 8);
+            pass([shift](const uint8_t* item) -> size_t {
+                uint64_t key;
+                std::memcpy(&key, item, sizeof(key));
+                return (key >> shift) & 0xff;
+            });
+        }
+        std::swap(src, dst);
+    }
+
+    if (output != nullptr) {
+        KeyIndexSort::gather(data, output, record_length_, *src, pool_);
+    } else {
+        KeyIndexSort::permute(data, record_length_, *src);
+    }
+}
+
+} // namespace binsort
@@ -126,9 +126,25 @@ int64_t RecordView::extract_key(const KeySpec& spec) const {
             return value;
         }
         
-        case KeyType::LittleEndianFloat:
-            // Float comparison is handled separately
-            return 0;
+        case KeyType::LittleEndianFloat: {
+            // Map IEEE 754 bits to a signed integer with totalOrder
+            // semantics: negative values get their magnitude bits flipped
+            int64_t bits = 0;
+            switch (spec.length) {
+                case 2:
+                    bits = static_cast<int16_t>(read_le16(ptr));
+                    break;
+                case 4:
+                    bits = static_cast<int32_t>(read_le32(ptr));
+                    break;
+                case 8:
+                    bits = static_cast<int64_t>(read_le64(ptr));
+                    break;
+                default:
+                    throw std::invalid_argument("Invalid float length");
+            }
+            return bits ^ static_cast<int64_t>(static_cast<uint64_t>(bits >> 63) >> 1);
+        }
     }
     
     return 0;
@@ -161,16 +177,8 @@ int RecordComparator::compare(const RecordView& a, const RecordView& b) const {
             const uint8_t* pb = b.data() + key.offset();
             cmp = std::memcmp(pa, pb, key.length);
         }
-        else if (key.type == KeyType::LittleEndianFloat) {
-            // Floating-point comparison
-            double va = a.extract_float_key(key);
-            double vb = b.extract_float_key(key);
-            if (va < vb) cmp = -1;
-            else if (va > vb) cmp = 1;
-            else cmp = 0;
-        }
         else {
-            // Integer comparison
+            // Integer comparison (floats are extracted in total order)
             int64_t va = a.extract_key(key);
             int64_t vb = b.extract_key(key);
             if (va < vb) cmp = -1;
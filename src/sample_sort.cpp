@@ -0,0 +1,370 @@
+#include "sample_sort.hpp"
+#include "memory_placement.hpp"
+#include "sort_engine.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace binsort {
+
+namespace {
+
+// Records classified together, one tree level at a time, so the
+// comparisons of a batch are independent
+constexpr size_t kClassifyBatch = 16;
+
+constexpr size_t kNone = static_cast<size_t>(-1);
+
+struct Stripe {
+    size_t begin;                       // First record
+    size_t end;                         // One past the last record
+    size_t written;                     // Full blocks are written back up to here
+    std::vector<size_t> counts;         // Records per bucket
+    std::vector<uint8_t> buffers;       // One block-sized buffer per bucket
+    std::vector<size_t> fill;           // Records in each buffer
+    std::vector<uint8_t> block_buckets; // Bucket of each written block
+};
+
+} // namespace
+
+SampleSort::SampleSort(size_t record_length, Comparator compare, ThreadPool& pool, BucketSort bucket_sort)
+    : record_length_(record_length)
+    , compare_(compare)
+    , pool_(pool)
+    , bucket_sort_(bucket_sort) {}
+
+void SampleSort::build_tree(const uint8_t* data, size_t record_count) {
+    const size_t record_length = record_length_;
+
+    bucket_count_ = 2;
+    tree_levels_ = 1;
+    while (bucket_count_ < kMaxBuckets && bucket_count_ * 2 * kMinBucketRecords <= record_count) {
+        bucket_count_ *= 2;
+        tree_levels_++;
+    }
+
+    // Oversampled random sample, sorted; every kOversampling-th record
+    // becomes a splitter
+    const size_t sample_count = std::min(record_count, bucket_count_ * kOversampling);
+    std::vector<uint8_t> sample(sample_count * record_length);
+    std::mt19937_64 gen(record_count);
+    for (size_t i = 0; i < sample_count; ++i) {
+        const size_t index = gen() % record_count;
+        std::memcpy(sample.data() + i * record_length, data + index * record_length, record_length);
+    }
+    RecordQuickSort sorter(record_length, compare_);
+    sorter.sort(sample.data(), sample_count);
+
+    const size_t splitters = bucket_count_ - 1;
+    auto sorted_splitter = [&](size_t i) {
+        const size_t index = std::min(sample_count - 1, (i + 1) * sample_count / bucket_count_);
+        return sample.data() + index * record_length;
+    };
+
+    // Heap order: node n has children 2n and 2n + 1; an in-order walk of
+    // the complete tree visits the sorted splitters
+    tree_.assign(bucket_count_ * record_length, 0);
+    struct Range { size_t node, first, count; };
+    std::vector<Range> pending = {{1, 0, splitters}};
+    while (!pending.empty()) {
+        const Range range = pending.back();
+        pending.pop_back();
+        if (range.count == 0) continue;
+        const size_t half = range.count / 2;
+        std::memcpy(tree_.data() + range.node * record_length, sorted_splitter(range.first + half), record_length);
+        pending.push_back({2 * range.node, range.first, half});
+        pending.push_back({2 * range.node + 1, range.first + half + 1, half});
+    }
+}
+
+void SampleSort::classify(const uint8_t* records, size_t count, uint8_t* buckets) const {
+    const size_t record_length = record_length_;
+    size_t node[kClassifyBatch];
+
+    for (size_t base = 0; base < count; base += kClassifyBatch) {
+        const size_t batch = std::min(kClassifyBatch, count - base);
+        const uint8_t* first = records + base * record_length;
+
+        for (size_t j = 0; j < batch; ++j) node[j] = 1;
+
+        // Records equal to a splitter go left
+        for (size_t level = 0; level < tree_levels_; ++level) {
+            for (size_t j = 0; j < batch; ++j) {
+                const bool right = compare_(splitter(node[j]), first + j * record_length) < 0;
+                node[j] = 2 * node[j] + (right ? 1 : 0);
+            }
+        }
+
+        for (size_t j = 0; j < batch; ++j) {
+            buckets[base + j] = static_cast<uint8_t>(node[j] - bucket_count_);
+        }
+    }
+}
+
+void SampleSort::sort_buckets(uint8_t* data, const std::vector<size_t>& starts) {
+    // Largest buckets first so the long tasks start early
+    std::vector<size_t> order(bucket_count_);
+    for (size_t b = 0; b < bucket_count_; ++b) order[b] = b;
+    std::sort(order.begin(), order.end(), [&starts](size_t a, size_t b) {
+        return starts[a + 1] - starts[a] > starts[b + 1] - starts[b];
+    });
+
+    pool_.parallel_for(bucket_count_, [&](size_t i) {
+        const size_t b = order[i];
+        if (bucket_sort_ != nullptr) {
+            bucket_sort_(data + starts[b] * record_length_, starts[b + 1] - starts[b], &pool_);
+            return;
+        }
+        RecordQuickSort sorter(record_length_, compare_, &pool_);
+        sorter.sort(data + starts[b] * record_length_, starts[b + 1] - starts[b]);
+    });
+}
+
+void SampleSort::sort(const uint8_t* input, uint8_t* output, size_t record_count) {
+    const size_t record_length = record_length_;
+    if (record_count <= 1) {
+        std::memcpy(output, input, record_count * record_length);
+        return;
+    }
+
+    build_tree(input, record_count);
+    const size_t buckets = bucket_count_;
+    const size_t stripes = pool_.size();
+    const size_t per_stripe = (record_count + stripes - 1) / stripes;
+
+    // Classify once, remembering each record's bucket
+    PlacedVector<uint8_t> oracle(record_count);
+    std::vector<std::vector<size_t>> positions(stripes, std::vector<size_t>(buckets, 0));
+
+    pool_.parallel_for(stripes, [&](size_t t) {
+        const size_t begin = std::min(record_count, t * per_stripe);
+        const size_t end = std::min(record_count, begin + per_stripe);
+        classify(input + begin * record_length, end - begin, oracle.data() + begin);
+        for (size_t i = begin; i < end; ++i) positions[t][oracle[i]]++;
+    });
+
+    // Bucket-major, stripe-minor offsets
+    std::vector<size_t> starts(buckets + 1, 0);
+    size_t sum = 0;
+    for (size_t b = 0; b < buckets; ++b) {
+        starts[b] = sum;
+        for (size_t t = 0; t < stripes; ++t) {
+            const size_t n = positions[t][b];
+            positions[t][b] = sum;
+            sum += n;
+        }
+    }
+    starts[buckets] = sum;
+
+    pool_.parallel_for(stripes, [&](size_t t) {
+        const size_t begin = std::min(record_count, t * per_stripe);
+        const size_t end = std::min(record_count, begin + per_stripe);
+        auto& pos = positions[t];
+        for (size_t i = begin; i < end; ++i) {
+            std::memcpy(output + pos[oracle[i]]++ * record_length, input + i * record_length, record_length);
+        }
+    });
+
+    sort_buckets(output, starts);
+}
+
+void SampleSort::sort(uint8_t* data, size_t record_count) {
+    const size_t record_length = record_length_;
+    if (record_count <= 1) return;
+
+    build_tree(data, record_count);
+    const size_t buckets = bucket_count_;
+    const size_t block_records = std::max<size_t>(1, kBlockBytes / record_length);
+    const size_t block_bytes = block_records * record_length;
+
+    // Block positions cover the array; the last may be partial
+    const size_t positions = (record_count + block_records - 1) / block_records;
+
+    // Stripes start on block boundaries
+    const size_t stripe_count = std::min(pool_.size(), positions);
+    const size_t stripe_blocks = (positions + stripe_count - 1) / stripe_count;
+    std::vector<Stripe> stripes;
+    for (size_t t = 0; t < stripe_count; ++t) {
+        const size_t begin = std::min(record_count, t * stripe_blocks * block_records);
+        const size_t end = std::min(record_count, begin + stripe_blocks * block_records);
+        if (begin == end) break;
+        stripes.push_back({begin, end, begin, {}, {}, {}, {}});
+    }
+
+    // Local classification: fill per-bucket buffers and write full blocks
+    // back over records this stripe has already read
+    pool_.parallel_for(stripes.size(), [&](size_t t) {
+        Stripe& stripe = stripes[t];
+        stripe.counts.assign(buckets, 0);
+        stripe.buffers.resize(buckets * block_bytes);
+        stripe.fill.assign(buckets, 0);
+
+        uint8_t ids[kClassifyBatch];
+        for (size_t pos = stripe.begin; pos < stripe.end; pos += kClassifyBatch) {
+            const size_t batch = std::min(kClassifyBatch, stripe.end - pos);
+            classify(data + pos * record_length, batch, ids);
+
+            for (size_t j = 0; j < batch; ++j) {
+                const size_t b = ids[j];
+                uint8_t* buffer = stripe.buffers.data() + b * block_bytes;
+                std::memcpy(buffer + stripe.fill[b] * record_length, data + (pos + j) * record_length, record_length);
+                stripe.counts[b]++;
+
+                // At least block_records more records have been read than
+                // written, so this never overwrites unread records
+                if (++stripe.fill[b] == block_records) {
+                    std::memcpy(data + stripe.written * record_length, buffer, block_bytes);
+                    stripe.written += block_records;
+                    stripe.block_buckets.push_back(static_cast<uint8_t>(b));
+                    stripe.fill[b] = 0;
+                }
+            }
+        }
+    });
+
+    // Bucket boundaries; each bucket's full blocks go to consecutive block
+    // positions starting at its first block boundary
+    std::vector<size_t> starts(buckets + 1, 0);
+    std::vector<size_t> full_blocks(buckets, 0);
+    for (size_t b = 0; b < buckets; ++b) {
+        size_t count = 0;
+        for (const auto& stripe : stripes) count += stripe.counts[b];
+        starts[b + 1] = starts[b] + count;
+    }
+    for (const auto& stripe : stripes) {
+        for (uint8_t b : stripe.block_buckets) full_blocks[b]++;
+    }
+
+    std::vector<size_t> next_slot(buckets);
+    for (size_t b = 0; b < buckets; ++b) {
+        next_slot[b] = (starts[b] + block_records - 1) / block_records;
+    }
+
+    std::vector<size_t> target_of(positions, kNone);
+    std::vector<size_t> source_of(positions, kNone);
+    for (const auto& stripe : stripes) {
+        for (size_t j = 0; j < stripe.block_buckets.size(); ++j) {
+            const size_t position = stripe.begin / block_records + j;
+            const size_t slot = next_slot[stripe.block_buckets[j]]++;
+            target_of[position] = slot;
+            source_of[slot] = position;
+        }
+    }
+
+    // A partial last block position is backed by an overflow buffer
+    const bool partial_last = record_count % block_records != 0;
+    std::vector<uint8_t> overflow(partial_last ? block_bytes : 0);
+    auto block_at = [&](size_t position) -> uint8_t* {
+        return (partial_last && position == positions - 1)
+            ? overflow.data()
+            : data + position * block_bytes;
+    };
+
+    // Plan the block moves as chains ending at a vacant position and
+    // cycles; each is independent and moves run in parallel. A move list
+    // [p0, p1, ..., pm] fills p0 from p1, then p1 from p2, and so on; a
+    // cycle's last position receives the original p0.
+    std::vector<size_t> moves;
+    std::vector<size_t> move_starts;
+    std::vector<bool> move_is_cycle;
+
+    for (size_t slot = 0; slot < positions; ++slot) {
+        if (source_of[slot] == kNone || target_of[slot] != kNone) continue;
+        move_starts.push_back(moves.size());
+        move_is_cycle.push_back(false);
+        for (size_t p = slot; p != kNone;) {
+            moves.push_back(p);
+            target_of[p] = kNone;
+            const size_t next = source_of[p];
+            source_of[p] = kNone;
+            p = next;
+        }
+    }
+    for (size_t start = 0; start < positions; ++start) {
+        if (target_of[start] == kNone) continue;
+        if (target_of[start] == start) {
+            target_of[start] = kNone;
+            continue;
+        }
+        move_starts.push_back(moves.size());
+        move_is_cycle.push_back(true);
+        size_t p = start;
+        do {
+            moves.push_back(p);
+            target_of[p] = kNone;
+            p = source_of[p];
+        } while (p != start);
+    }
+    move_starts.push_back(moves.size());
+
+    const size_t plans = move_is_cycle.size();
+    const size_t tasks = std::max<size_t>(1, std::min(pool_.size(), plans));
+    pool_.parallel_for(tasks, [&](size_t t) {
+        std::vector<uint8_t> temp(block_bytes);
+        for (size_t plan = t; plan < plans; plan += tasks) {
+            const size_t first = move_starts[plan];
+            const size_t last = move_starts[plan + 1] - 1;
+            if (move_is_cycle[plan]) {
+                std::memcpy(temp.data(), block_at(moves[first]), block_bytes);
+            }
+            for (size_t i = first; i < last; ++i) {
+                std::memcpy(block_at(moves[i]), block_at(moves[i + 1]), block_bytes);
+            }
+            if (move_is_cycle[plan]) {
+                std::memcpy(block_at(moves[last]), temp.data(), block_bytes);
+            }
+        }
+    });
+
+    // Records are now addressed through a virtual array that continues
+    // into the overflow buffer past the end
+    const size_t overflow_start = (positions - 1) * block_records;
+    if (partial_last) {
+        std::memcpy(data + overflow_start * record_length, overflow.data(),
+                    (record_count - overflow_start) * record_length);
+    }
+    auto record_at = [&](size_t index) -> const uint8_t* {
+        return index < record_count
+            ? data + index * record_length
+            : overflow.data() + (index - overflow_start) * record_length;
+    };
+
+    // A bucket's last block may spill past its end into the next bucket's
+    // head; move the excess into its own head, which lies before its first
+    // block boundary. In bucket order, so each head is free when written.
+    std::vector<size_t> head_used(buckets, 0);
+    for (size_t b = 0; b < buckets; ++b) {
+        if (full_blocks[b] == 0) continue;
+        const size_t blocks_begin = (starts[b] + block_records - 1) / block_records * block_records;
+        const size_t blocks_end = blocks_begin + full_blocks[b] * block_records;
+        for (size_t i = starts[b + 1]; i < blocks_end; ++i) {
+            std::memcpy(data + (starts[b] + head_used[b]) * record_length, record_at(i), record_length);
+            head_used[b]++;
+        }
+    }
+
+    // Partial buffers fill what is left of each bucket
+    pool_.parallel_for(buckets, [&](size_t b) {
+        size_t head = starts[b] + head_used[b];
+        size_t head_end = starts[b + 1];
+        size_t tail = starts[b + 1];
+        if (full_blocks[b] > 0) {
+            const size_t blocks_begin = (starts[b] + block_records - 1) / block_records * block_records;
+            const size_t blocks_end = blocks_begin + full_blocks[b] * block_records;
+            head_end = blocks_begin;
+            tail = std::min(blocks_end, starts[b + 1]);
+        }
+
+        for (auto& stripe : stripes) {
+            const uint8_t* buffer = stripe.buffers.data() + b * block_bytes;
+            for (size_t i = 0; i < stripe.fill[b]; ++i) {
+                const size_t index = head < head_end ? head++ : tail++;
+                std::memcpy(data + index * record_length, buffer + i * record_length, record_length);
+            }
+        }
+    });
+
+    sort_buckets(data, starts);
+}
+
+} // namespace binsort
@@ -0,0 +1,279 @@
+#include "simd_kernels.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if defined(BINSORT_X64_KERNELS)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace binsort {
+
+namespace simd {
+namespace baseline {
+
+#include "histogram_kernels.inl"
+
+} // namespace baseline
+} // namespace simd
+
+namespace {
+
+#if defined(BINSORT_X64_KERNELS)
+
+void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int out[4];
+    __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned>(out[i]);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state the OS saves on context switches (XCR0)
+uint64_t enabled_state() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t low = 0;
+    uint32_t high = 0;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (uint64_t(high) << 32) | low;
+#endif
+}
+
+bool has_bits(unsigned reg, unsigned bits) {
+    return (reg & bits) == bits;
+}
+
+// The kernel units are compiled for whole x86-64 levels, so the compiler
+// may use any instruction of a level, not only the vector ones
+SimdLevel detect() {
+    unsigned regs[4];
+    cpuid(0, 0, regs);
+    if (regs[0] < 7) return SimdLevel::Scalar;
+
+    cpuid(1, 0, regs);
+    const unsigned ecx1 = regs[2];
+    cpuid(7, 0, regs);
+    const unsigned ebx7 = regs[1];
+    cpuid(0x80000000, 0, regs);
+    unsigned ecx_ext = 0;
+    if (regs[0] >= 0x80000001) {
+        cpuid(0x80000001, 0, regs);
+        ecx_ext = regs[2];
+    }
+
+    // FMA, MOVBE, OSXSAVE, AVX, F16C; BMI1, AVX2, BMI2; LZCNT
+    constexpr unsigned kV3Leaf1 = (1u << 12) | (1u << 22) | (1u << 27) | (1u << 28) | (1u << 29);
+    constexpr unsigned kV3Leaf7 = (1u << 3) | (1u << 5) | (1u << 8);
+    constexpr unsigned kV3Extended = 1u << 5;
+    // AVX-512 F, DQ, CD, BW, VL
+    constexpr unsigned kV4Leaf7 = (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31);
+
+    if (!has_bits(ecx1, kV3Leaf1) || !has_bits(ebx7, kV3Leaf7) || !has_bits(ecx_ext, kV3Extended)) {
+        return SimdLevel::Scalar;
+    }
+    // The OS must also save the vector registers on context switches
+    const uint64_t state = enabled_state();
+    constexpr uint64_t kVectorState = 0x6;     // XMM, YMM
+    constexpr uint64_t kAVX512State = 0xe6;    // and opmask, ZMM
+    if ((state & kVectorState) != kVectorState) return SimdLevel::Scalar;
+    if (has_bits(ebx7, kV4Leaf7) && (state & kAVX512State) == kAVX512State) return SimdLevel::AVX512;
+    return SimdLevel::AVX2;
+}
+
+#else
+
+SimdLevel detect() {
+    return SimdLevel::Scalar;
+}
+
+#endif
+
+using Entry = KeyIndexSort::Entry;
+static_assert(sizeof(Entry) == 2 * sizeof(uint64_t), "Kernels treat entries as qword pairs");
+
+using Partition = size_t (*)(uint64_t* entries, size_t count, uint64_t prefix, uint64_t index);
+
+// Ranges this small go to std::sort; at least two AVX-512 vectors
+constexpr size_t kSmallSort = 32;
+
+bool entry_before(const Entry& a, const Entry& b) {
+    return a.prefix < b.prefix || (a.prefix == b.prefix && a.index < b.index);
+}
+
+const Entry& median_of_three(const Entry& a, const Entry& b, const Entry& c) {
+    if (entry_before(a, b)) {
+        if (entry_before(b, c)) return b;
+        return entry_before(a, c) ? c : a;
+    }
+    if (entry_before(a, c)) return a;
+    return entry_before(b, c) ? c : b;
+}
+
+void quicksort(Entry* entries, size_t count, Partition partition, unsigned depth) {
+    while (count > kSmallSort) {
+        if (depth == 0) {
+            std::sort(entries, entries + count, entry_before);
+            return;
+        }
+        depth--;
+
+        // Median of three, or of three medians for larger ranges. Samples
+        // are distinct, so both sides of the split are nonempty.
+        const size_t step = count / 8;
+        const Entry pivot = (count < 1024)
+            ? median_of_three(entries[2 * step], entries[4 * step], entries[6 * step])
+            : median_of_three(
+                  median_of_three(entries[step], entries[2 * step], entries[3 * step]),
+                  median_of_three(entries[3 * step + 1], entries[4 * step], entries[5 * step]),
+                  median_of_three(entries[5 * step + 1], entries[6 * step], entries[7 * step]));
+
+        const size_t split = partition(reinterpret_cast<uint64_t*>(entries), count, pivot.prefix, pivot.index);
+
+        // Recurse into the smaller side to bound the stack
+        if (split < count - split) {
+            quicksort(entries, split, partition, depth);
+            entries += split;
+            count -= split;
+        } else {
+            quicksort(entries + split, count - split, partition, depth);
+            count = split;
+        }
+    }
+    std::sort(entries, entries + count, entry_before);
+}
+
+} // namespace
+
+SimdLevel detected_simd_level() {
+    static const SimdLevel level = [] {
+        SimdLevel best = detect();
+        if (const char* cap = std::getenv("BINSORT_SIMD")) {
+            const std::string name = cap;
+            if (name == "scalar") best = SimdLevel::Scalar;
+            if (name == "avx2") best = std::min(best, SimdLevel::AVX2);
+        }
+        return best;
+    }();
+    return level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::AVX2:   return "AVX2 (x86-64-v3)";
+        case SimdLevel::AVX512: return "AVX-512 (x86-64-v4)";
+    }
+    return "unknown";
+}
+
+PrefixGather::PrefixGather(const KeyNormalizer& normalizer, SimdLevel level)
+    : normalizer_(normalizer)
+    , level_(level) {
+    const size_t width = std::min<size_t>(8, normalizer.key_width());
+    size_t offsets[8];
+    uint8_t masks[8];
+    size_t low = std::numeric_limits<size_t>::max();
+    size_t high = 0;
+    for (size_t p = 0; p < width; ++p) {
+        if (!normalizer.byte_source(p, offsets[p], masks[p])) {
+            level_ = SimdLevel::Scalar;
+            return;
+        }
+        low = std::min(low, offsets[p]);
+        high = std::max(high, offsets[p]);
+    }
+    if (width == 0 || high - low >= 16) {
+        level_ = SimdLevel::Scalar;
+        return;
+    }
+
+    plan_.window = low;
+    std::fill(std::begin(plan_.shuffle), std::end(plan_.shuffle), uint8_t(0x80));
+    for (size_t p = 0; p < width; ++p) {
+        // Big-endian prefix byte p is byte 7 - p of the little-endian qword
+        plan_.shuffle[7 - p] = static_cast<uint8_t>(offsets[p] - low);
+        plan_.flip[7 - p] = masks[p];
+    }
+}
+
+void PrefixGather::build(const uint8_t* data, size_t record_length, size_t record_count,
+                         size_t begin, size_t end, KeyIndexSort::Entry* entries) const {
+    size_t i = begin;
+#if defined(BINSORT_X64_KERNELS)
+    auto* out = reinterpret_cast<uint64_t*>(entries);
+    switch (level_) {
+        case SimdLevel::AVX512:
+            i = simd::avx512::gather_prefixes(plan_, data, record_length, record_count, begin, end, out);
+            break;
+        case SimdLevel::AVX2:
+            i = simd::avx2::gather_prefixes(plan_, data, record_length, record_count, begin, end, out);
+            break;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    for (; i < end; ++i) {
+        entries[i - begin] = {normalizer_.prefix(data + i * record_length), i};
+    }
+}
+
+void count_bytes(const uint8_t* bytes, size_t stride, size_t count, uint8_t mask, size_t* histogram,
+                 SimdLevel level) {
+#if defined(BINSORT_X64_KERNELS)
+    switch (level) {
+        case SimdLevel::AVX512: return simd::avx512::count_bytes(bytes, stride, count, mask, histogram);
+        case SimdLevel::AVX2:   return simd::avx2::count_bytes(bytes, stride, count, mask, histogram);
+        case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    simd::baseline::count_bytes(bytes, stride, count, mask, histogram);
+}
+
+void count_key_bytes(const uint8_t* items, size_t item_size, size_t count, size_t* histograms,
+                     SimdLevel level) {
+#if defined(BINSORT_X64_KERNELS)
+    switch (level) {
+        case SimdLevel::AVX512: return simd::avx512::count_key_bytes(items, item_size, count, histograms);
+        case SimdLevel::AVX2:   return simd::avx2::count_key_bytes(items, item_size, count, histograms);
+        case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    simd::baseline::count_key_bytes(items, item_size, count, histograms);
+}
+
+void sort_entries_by_prefix(KeyIndexSort::Entry* entries, size_t count, SimdLevel level) {
+    Partition partition = nullptr;
+#if defined(BINSORT_X64_KERNELS)
+    switch (level) {
+        case SimdLevel::AVX512: partition = simd::avx512::partition_entries; break;
+        case SimdLevel::AVX2:   partition = simd::avx2::partition_entries; break;
+        case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    if (partition == nullptr) {
+        std::sort(entries, entries + count, entry_before);
+        return;
+    }
+
+    unsigned depth = 0;
+    for (size_t n = count; n > 1; n >>= 1) depth += 2;
+    quicksort(entries, count, partition, depth);
+}
+
+} // namespace binsort
@@ -0,0 +1,136 @@
+// Built for x86-64-v3 (AVX2); see simd_isa.hpp before using anything else here
+#include "simd_isa.hpp"
+#include <immintrin.h>
+#include <string.h>
+
+namespace binsort {
+namespace simd {
+namespace avx2 {
+
+namespace {
+
+constexpr size_t kLanes = 2;   // Entries per vector
+
+// Entries of v, two qwords each, that sort before the pivot, as bits 0-1
+inline unsigned before_mask(__m256i v, __m256i pivot_biased) {
+    // No unsigned 64-bit compare before AVX-512: bias both sides
+    const __m256i biased = _mm256_xor_si256(v, _mm256_set1_epi64x(INT64_MIN));
+    const __m256i lt = _mm256_cmpgt_epi64(pivot_biased, biased);
+    const __m256i eq = _mm256_cmpeq_epi64(pivot_biased, biased);
+    const unsigned less = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+    const unsigned equal = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+    // Prefix below, or prefix equal and index below
+    const unsigned before = less | (equal & (less >> 1));
+    return (before & 1) | ((before >> 1) & 2);
+}
+
+inline bool before(const uint64_t* entry, uint64_t prefix, uint64_t index) {
+    return entry[0] < prefix || (entry[0] == prefix && entry[1] < index);
+}
+
+} // namespace
+
+#include "histogram_kernels.inl"
+
+size_t gather_prefixes(const GatherPlan& plan, const uint8_t* data, size_t record_length,
+                       size_t record_count, size_t begin, size_t end, uint64_t* entries) {
+    const size_t bytes = record_count * record_length;
+    if (bytes < plan.window + 16) return begin;
+    const size_t loadable = (bytes - plan.window - 16) / record_length + 1;
+    const size_t stop = (end < loadable) ? end : loadable;
+
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plan.shuffle)));
+    const __m256i flip = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plan.flip)));
+    const __m256i step = _mm256_set_epi64x(2, 0, 2, 0);
+    __m256i index = _mm256_set_epi64x(static_cast<long long>(begin + 1), 0,
+                                      static_cast<long long>(begin), 0);
+
+    size_t i = begin;
+    const uint8_t* window = data + begin * record_length + plan.window;
+    for (; i + kLanes <= stop; i += kLanes, window += kLanes * record_length) {
+        const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(window));
+        const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(window + record_length));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        v = _mm256_xor_si256(_mm256_shuffle_epi8(v, shuffle), flip);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(entries + 2 * (i - begin)), _mm256_or_si256(v, index));
+        index = _mm256_add_epi64(index, step);
+    }
+    return i;
+}
+
+size_t partition_entries(uint64_t* entries, size_t count, uint64_t prefix, uint64_t index) {
+    // Permutations putting the entries before the pivot first
+    alignas(32) static const int kPermute[4][8] = {
+        {0, 1, 2, 3, 4, 5, 6, 7},
+        {0, 1, 2, 3, 4, 5, 6, 7},
+        {4, 5, 6, 7, 0, 1, 2, 3},
+        {0, 1, 2, 3, 4, 5, 6, 7},
+    };
+    static const unsigned kCount[4] = {0, 1, 1, 2};
+
+    const __m256i pivot = _mm256_xor_si256(
+        _mm256_set_epi64x(static_cast<long long>(index), static_cast<long long>(prefix),
+                          static_cast<long long>(index), static_cast<long long>(prefix)),
+        _mm256_set1_epi64x(INT64_MIN));
+    auto load = [entries](size_t at) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(entries + 2 * at));
+    };
+
+    // The first and last vector are set aside so that every vector read
+    // frees room for its writes on both sides: each side then keeps at
+    // least kLanes free slots, read from whichever has fewer
+    const __m256i first = load(0);
+    const __m256i last = load(count - kLanes);
+    size_t read_left = kLanes;
+    size_t read_right = count - kLanes;
+    size_t write_left = 0;
+    size_t write_right = count;
+
+    auto place = [&](__m256i v) {
+        const unsigned mask = before_mask(v, pivot);
+        const __m256i order = _mm256_load_si256(reinterpret_cast<const __m256i*>(kPermute[mask]));
+        const __m256i sorted = _mm256_permutevar8x32_epi32(v, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(entries + 2 * write_left), sorted);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(entries + 2 * (write_right - kLanes)), sorted);
+        write_left += kCount[mask];
+        write_right -= kLanes - kCount[mask];
+    };
+
+    while (read_right - read_left >= kLanes) {
+        __m256i v;
+        if (read_left - write_left <= write_right - read_right) {
+            v = load(read_left);
+            read_left += kLanes;
+        } else {
+            read_right -= kLanes;
+            v = load(read_right);
+        }
+        place(v);
+    }
+
+    // The unread rest and the two saved vectors fill the gap exactly
+    uint64_t rest[2 * 3 * kLanes];
+    size_t rest_count = read_right - read_left;
+    for (size_t i = 0; i < 2 * rest_count; ++i) {
+        rest[i] = entries[2 * read_left + i];
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(rest + 2 * rest_count), first);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(rest + 2 * (rest_count + kLanes)), last);
+    rest_count += 2 * kLanes;
+
+    for (size_t i = 0; i < rest_count; ++i) {
+        const uint64_t* entry = rest + 2 * i;
+        uint64_t* slot = before(entry, prefix, index)
+            ? entries + 2 * write_left++
+            : entries + 2 * --write_right;
+        slot[0] = entry[0];
+        slot[1] = entry[1];
+    }
+    return write_left;
+}
+
+} // namespace avx2
+} // namespace simd
+} // namespace binsort
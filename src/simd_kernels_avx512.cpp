@@ -0,0 +1,144 @@
+// Built for x86-64-v4 (AVX-512); see simd_isa.hpp before using anything else here
+#include "simd_isa.hpp"
+#include <immintrin.h>
+#include <string.h>
+
+namespace binsort {
+namespace simd {
+namespace avx512 {
+
+namespace {
+
+constexpr size_t kLanes = 4;   // Entries per vector
+
+// Qword permutations putting the entries flagged in the index first,
+// in order, then the others
+struct PermuteTable {
+    uint64_t order[16][8];
+    unsigned count[16];
+};
+
+constexpr PermuteTable make_permute_table() {
+    PermuteTable table{};
+    for (unsigned mask = 0; mask < 16; ++mask) {
+        unsigned out = 0;
+        for (unsigned flagged = 2; flagged-- > 0;) {
+            for (unsigned e = 0; e < kLanes; ++e) {
+                if (((mask >> e) & 1) != flagged) continue;
+                table.order[mask][2 * out] = 2 * e;
+                table.order[mask][2 * out + 1] = 2 * e + 1;
+                out++;
+            }
+        }
+        table.count[mask] = ((mask >> 0) & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+    return table;
+}
+
+constexpr PermuteTable kPermute = make_permute_table();
+
+// Entries of v, two qwords each, that sort before the pivot, as bits 0-3
+inline unsigned before_mask(__m512i v, __m512i pivot) {
+    const unsigned less = _mm512_cmplt_epu64_mask(v, pivot);
+    const unsigned equal = _mm512_cmpeq_epu64_mask(v, pivot);
+    // Prefix below, or prefix equal and index below
+    const unsigned before = less | (equal & (less >> 1));
+    return (before & 1) | ((before >> 1) & 2) | ((before >> 2) & 4) | ((before >> 3) & 8);
+}
+
+inline bool before(const uint64_t* entry, uint64_t prefix, uint64_t index) {
+    return entry[0] < prefix || (entry[0] == prefix && entry[1] < index);
+}
+
+} // namespace
+
+#include "histogram_kernels.inl"
+
+size_t gather_prefixes(const GatherPlan& plan, const uint8_t* data, size_t record_length,
+                       size_t record_count, size_t begin, size_t end, uint64_t* entries) {
+    const size_t bytes = record_count * record_length;
+    if (bytes < plan.window + 16) return begin;
+    const size_t loadable = (bytes - plan.window - 16) / record_length + 1;
+    const size_t stop = (end < loadable) ? end : loadable;
+
+    const __m512i shuffle = _mm512_broadcast_i32x4(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plan.shuffle)));
+    const __m512i flip = _mm512_broadcast_i32x4(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plan.flip)));
+    const __m512i step = _mm512_set_epi64(4, 0, 4, 0, 4, 0, 4, 0);
+    const long long first = static_cast<long long>(begin);
+    __m512i index = _mm512_set_epi64(first + 3, 0, first + 2, 0, first + 1, 0, first, 0);
+
+    size_t i = begin;
+    const uint8_t* window = data + begin * record_length + plan.window;
+    for (; i + kLanes <= stop; i += kLanes, window += kLanes * record_length) {
+        __m512i v = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i*>(window)));
+        v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(window + record_length)), 1);
+        v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(window + 2 * record_length)), 2);
+        v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(window + 3 * record_length)), 3);
+        v = _mm512_xor_si512(_mm512_shuffle_epi8(v, shuffle), flip);
+        _mm512_storeu_si512(entries + 2 * (i - begin), _mm512_or_si512(v, index));
+        index = _mm512_add_epi64(index, step);
+    }
+    return i;
+}
+
+size_t partition_entries(uint64_t* entries, size_t count, uint64_t prefix, uint64_t index) {
+    const long long p = static_cast<long long>(prefix);
+    const long long x = static_cast<long long>(index);
+    const __m512i pivot = _mm512_set_epi64(x, p, x, p, x, p, x, p);
+    auto load = [entries](size_t at) { return _mm512_loadu_si512(entries + 2 * at); };
+
+    // As in the AVX2 kernel: the first and last vector are set aside so
+    // that each side always has room for a whole vector
+    const __m512i first = load(0);
+    const __m512i last = load(count - kLanes);
+    size_t read_left = kLanes;
+    size_t read_right = count - kLanes;
+    size_t write_left = 0;
+    size_t write_right = count;
+
+    auto place = [&](__m512i v) {
+        const unsigned mask = before_mask(v, pivot);
+        const __m512i sorted = _mm512_permutexvar_epi64(_mm512_loadu_si512(kPermute.order[mask]), v);
+        _mm512_storeu_si512(entries + 2 * write_left, sorted);
+        _mm512_storeu_si512(entries + 2 * (write_right - kLanes), sorted);
+        write_left += kPermute.count[mask];
+        write_right -= kLanes - kPermute.count[mask];
+    };
+
+    while (read_right - read_left >= kLanes) {
+        __m512i v;
+        if (read_left - write_left <= write_right - read_right) {
+            v = load(read_left);
+            read_left += kLanes;
+        } else {
+            read_right -= kLanes;
+            v = load(read_right);
+        }
+        place(v);
+    }
+
+    uint64_t rest[2 * 3 * kLanes];
+    size_t rest_count = read_right - read_left;
+    for (size_t i = 0; i < 2 * rest_count; ++i) {
+        rest[i] = entries[2 * read_left + i];
+    }
+    _mm512_storeu_si512(rest + 2 * rest_count, first);
+    _mm512_storeu_si512(rest + 2 * (rest_count + kLanes), last);
+    rest_count += 2 * kLanes;
+
+    for (size_t i = 0; i < rest_count; ++i) {
+        const uint64_t* entry = rest + 2 * i;
+        uint64_t* slot = before(entry, prefix, index)
+            ? entries + 2 * write_left++
+            : entries + 2 * --write_right;
+        slot[0] = entry[0];
+        slot[1] = entry[1];
+    }
+    return write_left;
+}
+
+} // namespace avx512
+} // namespace simd
+} // namespace binsort
@@ -1,204 +1,410 @@
 #include "sort_engine.hpp"
+#include "adaptive_sort.hpp"
+#include "index_sort.hpp"
+#include "radix_sort.hpp"
+#include "sample_sort.hpp"
+#include "specialized_layouts.hpp"
 #include <algorithm>
-#include <execution>
 #include <vector>
-#include <thread>
 #include <cstring>
+#include <stdexcept>
 
 namespace binsort {
 
 SortEngine::SortEngine(const Config& config)
     : config_(config)
-    , compare_func_(nullptr)
-    , owns_func_(false) {
+    , pool_(config.pool) {
     
-    // Generate comparison function
-    if (ComparisonGenerator::is_available()) {
-        compare_func_ = ComparisonGenerator::generate(
-            config_.keys,
-            config_.record_length
-        );
-        owns_func_ = true;
+    if (!pool_) {
+        pool_ = std::make_shared<ThreadPool>(config_.thread_count);
+    }
+    
+    if (config_.specialize) {
+        layout_ = find_specialized_layout(config_.keys, config_.record_length);
+    }
+    if (layout_ != nullptr) {
+        compare_ = {layout_->compare, nullptr};
+        return;
+    }
+
+    // Generate comparison function, interpreting the keys if JIT is
+    // unavailable or cannot handle the layout
+    jit_func_ = ComparisonGenerator::generate(
+        config_.keys,
+        config_.record_length
+    );
+    if (jit_func_ != nullptr) {
+        compare_ = {jit_func_, nullptr};
     } else {
-        compare_func_ = InterpretedComparator::wrap(config_.keys);
-        owns_func_ = false;
+        interpreter_ = std::make_unique<InterpretedComparator>(config_.keys);
+        compare_ = interpreter_->bind();
     }
 }
 
 SortEngine::~SortEngine() {
-    if (owns_func_ && compare_func_ != nullptr) {
-        ComparisonGenerator::free_function(compare_func_);
+    if (jit_func_ != nullptr) {
+        ComparisonGenerator::free_function(jit_func_);
     }
 }
 
-void SortEngine::swap_records(uint8_t* a, uint8_t* b) const {
-    // Use temporary buffer for swap
-    uint8_t temp[256];
-    const size_t len = config_.record_length;
-    
-    if (len <= sizeof(temp)) {
-        std::memcpy(temp, a, len);
-        std::memcpy(a, b, len);
-        std::memcpy(b, temp, len);
-    } else {
-        // For larger records, allocate dynamically
-        std::vector<uint8_t> temp_vec(len);
-        std::memcpy(temp_vec.data(), a, len);
-        std::memcpy(a, b, len);
-        std::memcpy(b, temp_vec.data(), len);
+SortAlgorithm SortEngine::selected_algorithm(size_t record_count) const {
+    if (config_.algorithm == SortAlgorithm::Radix && !RadixSort::supports(config_.keys)) {
+        throw std::runtime_error("Radix sort requires keys totalling at most 8 bytes");
+    }
+    SortAlgorithm algorithm = config_.algorithm;
+    if (algorithm == SortAlgorithm::Auto) {
+        // Radix needs a few passes over the data regardless of n, so it only
+        // pays off on larger inputs
+        if (RadixSort::supports(config_.keys) && record_count >= kRadixMinRecords) {
+            algorithm = SortAlgorithm::Radix;
+        // Moving wide records costs far more than moving 16-byte entries
+        } else if (config_.record_length >= kKeyIndexMinRecordLength) {
+            algorithm = SortAlgorithm::KeyIndex;
+        } else {
+            algorithm = SortAlgorithm::QuickSort;
+        }
+    }
+    // The record index in each entry breaks ties for free, where a stable
+    // quicksort or sample sort would need an extra buffer or pass
+    if (config_.stable && algorithm == SortAlgorithm::QuickSort) {
+        algorithm = SortAlgorithm::KeyIndex;
     }
+    return algorithm;
+}
+
+bool SortEngine::is_sorted(const uint8_t* data, size_t record_count) const {
+    if (!config_.adaptive) return false;
+    AdaptiveSort adaptive(config_.record_length, compare_, config_.stable, *pool_);
+    return adaptive.is_sorted(data, record_count);
 }
 
 void SortEngine::sort(uint8_t* data, size_t record_count) {
-    if (record_count <= 1) return;
-    
-    const size_t records_per_thread = std::max(
-        size_t(1000),  // Minimum chunk size
-        record_count / config_.thread_count
-    );
+    sort_records(data, nullptr, record_count);
+}
+
+void SortEngine::sort(uint8_t* input, uint8_t* output, size_t record_count) {
+    sort_records(input, output, record_count);
+}
+
+void SortEngine::sort_records(uint8_t* data, uint8_t* output, size_t record_count) {
+    const size_t record_length = config_.record_length;
+
+    if (record_count <= 1) {
+        if (output != nullptr && record_count == 1) {
+            std::memcpy(output, data, record_length);
+        }
+        return;
+    }
+
+    const SortAlgorithm algorithm = selected_algorithm(record_count);
+
+    if (config_.adaptive) {
+        AdaptiveSort adaptive(record_length, compare_, config_.stable, *pool_);
+        const auto sort_tail = [this](uint8_t* tail, size_t count) { sort_records(tail, nullptr, count); };
+        if (adaptive.sort(data, output, record_count, sort_tail)) {
+            return;
+        }
+    }
+
+    if (algorithm == SortAlgorithm::Radix) {
+        RadixSort sorter(
+            config_.record_length,
+            config_.keys,
+            *pool_
+        );
+        if (output != nullptr) {
+            sorter.sort(data, output, record_count);
+        } else {
+            sorter.sort(data, record_count);
+        }
+        return;
+    }
+
+    if (algorithm == SortAlgorithm::KeyIndex) {
+        KeyIndexSort sorter(
+            config_.record_length,
+            config_.keys,
+            *pool_
+        );
+        if (output != nullptr) {
+            sorter.sort(data, output, record_count);
+        } else {
+            sorter.sort(data, record_count);
+        }
+        return;
+    }
     
-    // If data is small or single-threaded, use simple quicksort
-    if (config_.thread_count == 1 || record_count < records_per_thread * 2) {
-        RecordQuickSort sorter(config_.record_length, compare_func_);
+    // Small inputs and single threads: one quicksort
+    if (pool_->size() == 1 || record_count < kSampleSortMinRecords) {
+        if (output != nullptr) {
+            std::memcpy(output, data, record_count * record_length);
+            data = output;
+        }
+        if (layout_ != nullptr) {
+            layout_->sort(data, record_count, pool_.get());
+            return;
+        }
+        RecordQuickSort sorter(config_.record_length, compare_, pool_.get());
         sorter.sort(data, record_count);
         return;
     }
-    
-    // Parallel sort: partition into chunks
-    std::vector<Chunk> chunks;
-    size_t offset = 0;
-    
-    while (offset < record_count) {
-        size_t chunk_size = std::min(records_per_thread, record_count - offset);
-        chunks.push_back({
-            data + offset * config_.record_length,
-            chunk_size
-        });
-        offset += chunk_size;
+
+    // Otherwise distribute into buckets by sampled splitters and quicksort
+    // the buckets in parallel; no merge
+    SampleSort sorter(config_.record_length, compare_, *pool_,
+                      layout_ != nullptr ? layout_->sort : nullptr);
+    if (output != nullptr) {
+        sorter.sort(data, output, record_count);
+    } else {
+        sorter.sort(data, record_count);
     }
-    
-    // Sort each chunk in parallel
-    std::vector<std::thread> threads;
-    for (auto& chunk : chunks) {
-        threads.emplace_back([this, chunk]() {
-            RecordQuickSort sorter(config_.record_length, compare_func_);
-            sorter.sort(chunk.start, chunk.record_count);
-        });
+}
+
+void RecordQuickSort::sort(uint8_t* data, size_t record_count) {
+    if (record_count <= 1) return;
+    data_ = data;
+
+    // Number of highly unbalanced partitions tolerated before heapsort
+    int bad_allowed = 0;
+    for (size_t n = record_count; n > 1; n >>= 1) ++bad_allowed;
+
+    if (pool_ == nullptr || pool_->size() == 1 || record_count < 2 * kParallelMinRecords) {
+        sort_loop(0, record_count, bad_allowed, true);
+        return;
     }
-    
-    // Wait for all threads
-    for (auto& thread : threads) {
-        thread.join();
+
+    ThreadPool::TaskGroup group(*pool_);
+    group_ = &group;
+    sort_loop(0, record_count, bad_allowed, true);
+    group.wait();
+    group_ = nullptr;
+}
+
+void RecordQuickSort::sort_side(size_t begin, size_t end, int bad_allowed, bool leftmost) {
+    if (group_ == nullptr || end - begin < kParallelMinRecords) {
+        sort_loop(begin, end, bad_allowed, leftmost);
+        return;
     }
-    
-    // Merge sorted chunks
-    merge_chunks(data, chunks);
+
+    // Forked sides touch disjoint ranges and only read the pivot before
+    // them, so each task just needs its own scratch record
+    const size_t record_length = record_length_;
+    const Comparator compare = compare_;
+    ThreadPool::TaskGroup* group = group_;
+    uint8_t* data = data_;
+    group_->run([=]() {
+        RecordQuickSort side(record_length, compare);
+        side.data_ = data;
+        side.group_ = group;
+        side.sort_loop(begin, end, bad_allowed, leftmost);
+    });
 }
 
-void SortEngine::merge_chunks(
-    uint8_t* data,
-    const std::vector<Chunk>& chunks
-) {
-    if (chunks.size() <= 1) return;
-    
-    // Simple k-way merge using temporary buffer
-    const size_t total_records = [&chunks]() {
-        size_t sum = 0;
-        for (const auto& chunk : chunks) sum += chunk.record_count;
-        return sum;
-    }();
-    
-    std::vector<uint8_t> temp(total_records * config_.record_length);
-    
-    // Indices for each chunk
-    std::vector<size_t> indices(chunks.size(), 0);
-    
-    // Merge
-    for (size_t out = 0; out < total_records; ++out) {
-        // Find minimum among chunk heads
-        int min_chunk = -1;
-        
-        for (size_t i = 0; i < chunks.size(); ++i) {
-            if (indices[i] >= chunks[i].record_count) continue;
-            
-            if (min_chunk == -1) {
-                min_chunk = i;
-            } else {
-                const uint8_t* a = chunks[i].start + 
-                    indices[i] * config_.record_length;
-                const uint8_t* b = chunks[min_chunk].start + 
-                    indices[min_chunk] * config_.record_length;
-                
-                if (compare_func_(a, b) < 0) {
-                    min_chunk = i;
-                }
+void RecordQuickSort::sort_loop(size_t begin, size_t end, int bad_allowed, bool leftmost) {
+    while (true) {
+        const size_t size = end - begin;
+
+        if (size < kInsertionSortThreshold) {
+            insertion_sort(begin, end);
+            return;
+        }
+
+        // Move the pivot candidate to begin
+        const size_t mid = begin + size / 2;
+        if (size > kNintherThreshold) {
+            sort3(begin, mid, end - 1);
+            sort3(begin + 1, mid - 1, end - 2);
+            sort3(begin + 2, mid + 1, end - 3);
+            sort3(mid - 1, mid, mid + 1);
+            swap_records(at(begin), at(mid));
+        } else {
+            sort3(mid, begin, end - 1);
+        }
+
+        // If the pivot equals the element before this range, every element
+        // equal to it belongs here: group them on the left and skip them
+        if (!leftmost && !less(begin - 1, begin)) {
+            begin = partition_left(begin, end) + 1;
+            continue;
+        }
+
+        bool already_partitioned = false;
+        const size_t pivot = partition_right(begin, end, already_partitioned);
+
+        const size_t left_size = pivot - begin;
+        const size_t right_size = end - (pivot + 1);
+        const bool highly_unbalanced = left_size < size / 8 || right_size < size / 8;
+
+        if (highly_unbalanced) {
+            if (--bad_allowed == 0) {
+                heap_sort(begin, end);
+                return;
             }
+
+            // Break up patterns that defeat the pivot selection
+            if (left_size >= kInsertionSortThreshold) {
+                swap_records(at(begin), at(begin + left_size / 4));
+                swap_records(at(pivot - 1), at(pivot - left_size / 4));
+            }
+            if (right_size >= kInsertionSortThreshold) {
+                swap_records(at(pivot + 1), at(pivot + 1 + right_size / 4));
+                swap_records(at(end - 1), at(end - right_size / 4));
+            }
+        } else if (already_partitioned &&
+                   partial_insertion_sort(begin, pivot) &&
+                   partial_insertion_sort(pivot + 1, end)) {
+            // Input looked sorted and finishing it was cheap
+            return;
+        }
+
+        // Recurse into (or fork) the smaller side, loop on the larger one
+        if (left_size < right_size) {
+            sort_side(begin, pivot, bad_allowed, leftmost);
+            begin = pivot + 1;
+            leftmost = false;
+        } else {
+            sort_side(pivot + 1, end, bad_allowed, false);
+            end = pivot;
         }
-        
-        // Copy minimum record to output
-        const uint8_t* src = chunks[min_chunk].start + 
-            indices[min_chunk] * config_.record_length;
-        std::memcpy(
-            temp.data() + out * config_.record_length,
-            src,
-            config_.record_length
-        );
-        indices[min_chunk]++;
     }
-    
-    // Copy back to original buffer
-    std::memcpy(data, temp.data(), temp.size());
 }
 
-// QuickSort implementation
-void RecordQuickSort::sort(uint8_t* data, size_t record_count) {
-    if (record_count <= 1) return;
-    quicksort(data, 0, record_count - 1);
+size_t RecordQuickSort::partition_right(size_t begin, size_t end, bool& already_partitioned) {
+    // Pivot stays at begin until the end; elements equal to it go right
+    const uint8_t* pivot = at(begin);
+    size_t first = begin;
+    size_t last = end;
+
+    // Pivot selection guarantees an element >= pivot exists to the right
+    while (compare_(at(++first), pivot) < 0) {}
+
+    if (first - 1 == begin) {
+        while (first < last && compare_(at(--last), pivot) >= 0) {}
+    } else {
+        while (compare_(at(--last), pivot) >= 0) {}
+    }
+
+    already_partitioned = first >= last;
+
+    while (first < last) {
+        swap_records(at(first), at(last));
+        while (compare_(at(++first), pivot) < 0) {}
+        while (compare_(at(--last), pivot) >= 0) {}
+    }
+
+    const size_t pivot_pos = first - 1;
+    if (pivot_pos != begin) {
+        swap_records(at(begin), at(pivot_pos));
+    }
+    return pivot_pos;
+}
+
+size_t RecordQuickSort::partition_left(size_t begin, size_t end) {
+    // Elements equal to the pivot go left
+    const uint8_t* pivot = at(begin);
+    size_t first = begin;
+    size_t last = end;
+
+    while (compare_(pivot, at(--last)) < 0) {}
+
+    if (last + 1 == end) {
+        while (first < last && compare_(pivot, at(++first)) >= 0) {}
+    } else {
+        while (compare_(pivot, at(++first)) >= 0) {}
+    }
+
+    while (first < last) {
+        swap_records(at(first), at(last));
+        while (compare_(pivot, at(--last)) < 0) {}
+        while (compare_(pivot, at(++first)) >= 0) {}
+    }
+
+    if (last != begin) {
+        swap_records(at(begin), at(last));
+    }
+    return last;
 }
 
-void RecordQuickSort::quicksort(uint8_t* data, int64_t low, int64_t high) {
-    if (low < high) {
-        int64_t pi = partition(data, low, high);
-        quicksort(data, low, pi - 1);
-        quicksort(data, pi + 1, high);
+void RecordQuickSort::insertion_sort(size_t begin, size_t end) {
+    uint8_t* temp = scratch_.data();
+
+    for (size_t i = begin + 1; i < end; ++i) {
+        if (!less(i, i - 1)) continue;
+
+        // Shift the sorted prefix right in one move, then drop the record in
+        std::memcpy(temp, at(i), record_length_);
+        size_t j = i - 1;
+        while (j > begin && compare_(temp, at(j - 1)) < 0) --j;
+
+        std::memmove(at(j + 1), at(j), (i - j) * record_length_);
+        std::memcpy(at(j), temp, record_length_);
     }
 }
 
-int64_t RecordQuickSort::partition(uint8_t* data, int64_t low, int64_t high) {
-    uint8_t* pivot = data + high * record_length_;
-    int64_t i = low - 1;
-    
-    for (int64_t j = low; j < high; j++) {
-        uint8_t* current = data + j * record_length_;
-        if (compare_(current, pivot) < 0) {
-            i++;
-            swap_records(
-                data + i * record_length_,
-                current
-            );
-        }
+bool RecordQuickSort::partial_insertion_sort(size_t begin, size_t end) {
+    if (end - begin < 2) return true;
+
+    uint8_t* temp = scratch_.data();
+    size_t moved = 0;
+
+    for (size_t i = begin + 1; i < end; ++i) {
+        if (!less(i, i - 1)) continue;
+
+        std::memcpy(temp, at(i), record_length_);
+        size_t j = i - 1;
+        while (j > begin && compare_(temp, at(j - 1)) < 0) --j;
+
+        std::memmove(at(j + 1), at(j), (i - j) * record_length_);
+        std::memcpy(at(j), temp, record_length_);
+
+        moved += i - j;
+        if (moved > kPartialInsertionLimit) return false;
+    }
+    return true;
+}
+
+void RecordQuickSort::heap_sort(size_t begin, size_t end) {
+    const size_t count = end - begin;
+    for (size_t root = count / 2; root-- > 0;) {
+        sift_down(begin, root, count);
+    }
+    for (size_t last = count - 1; last > 0; --last) {
+        swap_records(at(begin), at(begin + last));
+        sift_down(begin, 0, last);
     }
-    
-    swap_records(
-        data + (i + 1) * record_length_,
-        pivot
-    );
-    
-    return i + 1;
+}
+
+void RecordQuickSort::sift_down(size_t begin, size_t root, size_t count) {
+    while (true) {
+        size_t child = 2 * root + 1;
+        if (child >= count) return;
+        if (child + 1 < count && less(begin + child, begin + child + 1)) ++child;
+        if (!less(begin + root, begin + child)) return;
+        swap_records(at(begin + root), at(begin + child));
+        root = child;
+    }
+}
+
+void RecordQuickSort::sort2(size_t a, size_t b) {
+    if (less(b, a)) swap_records(at(a), at(b));
+}
+
+void RecordQuickSort::sort3(size_t a, size_t b, size_t c) {
+    sort2(a, b);
+    sort2(b, c);
+    sort2(a, b);
 }
 
 void RecordQuickSort::swap_records(uint8_t* a, uint8_t* b) {
+    // Swap through a small stack buffer in blocks; no allocation for
+    // large records
     uint8_t temp[256];
     
-    if (record_length_ <= sizeof(temp)) {
-        std::memcpy(temp, a, record_length_);
-        std::memcpy(a, b, record_length_);
-        std::memcpy(b, temp, record_length_);
-    } else {
-        std::vector<uint8_t> temp_vec(record_length_);
-        std::memcpy(temp_vec.data(), a, record_length_);
-        std::memcpy(a, b, record_length_);
-        std::memcpy(b, temp_vec.data(), record_length_);
+    for (size_t done = 0; done < record_length_; done += sizeof(temp)) {
+        const size_t n = std::min(sizeof(temp), record_length_ - done);
+        std::memcpy(temp, a + done, n);
+        std::memcpy(a + done, b + done, n);
+        std::memcpy(b + done, temp, n);
     }
 }
 
@@ -0,0 +1,27 @@
+#include "specialized_layouts.hpp"
+#include <array>
+
+namespace binsort {
+
+namespace {
+
+template <typename... Layouts>
+struct LayoutList {
+    static constexpr std::array<SpecializedLayout, sizeof...(Layouts)> table = {specialize<Layouts>()...};
+};
+
+// Defines HotLayouts, the layouts compiled into the binary, from the
+// BINSORT_HOT_LAYOUTS CMake list. Each entry costs one sort and one
+// comparator instantiation.
+#include "hot_layouts.inl"
+
+} // namespace
+
+const SpecializedLayout* find_specialized_layout(const std::vector<KeySpec>& keys, size_t record_length) {
+    for (const SpecializedLayout& layout : HotLayouts::table) {
+        if (layout.matches(keys, record_length)) return &layout;
+    }
+    return nullptr;
+}
+
+} // namespace binsort
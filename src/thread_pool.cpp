@@ -0,0 +1,145 @@
+#include "thread_pool.hpp"
+
+namespace binsort {
+
+namespace {
+
+// Pool and queue of the worker running on this thread, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    const size_t workers = thread_count > 1 ? thread_count - 1 : 0;
+
+    for (size_t i = 0; i <= workers; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+
+    workers_.reserve(workers);
+    for (size_t i = 1; i <= workers; ++i) {
+        workers_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::current_queue() const {
+    return current_pool == this ? current_index : 0;
+}
+
+void ThreadPool::push(Task task) {
+    Queue& queue = *queues_[current_queue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+
+    // Taking the sleep mutex orders this push against a worker that is
+    // between checking queued_ and going to sleep
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    wake_.notify_one();
+}
+
+bool ThreadPool::try_run(size_t self) {
+    Task task;
+    bool found = false;
+
+    // Own work newest first, keeping the working set hot
+    {
+        Queue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // Steal the oldest, and typically largest, task of another queue
+    for (size_t k = 1; !found && k < queues_.size(); ++k) {
+        Queue& victim = *queues_[(self + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) return false;
+
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    execute(task);
+    return true;
+}
+
+void ThreadPool::execute(Task& task) {
+    TaskGroup* group = task.group;
+    try {
+        task.run();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(group->error_mutex_);
+        if (!group->error_) group->error_ = std::current_exception();
+    }
+    task.run = nullptr;
+
+    // The group may be destroyed as soon as pending_ reaches zero
+    group->pending_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        if (try_run(index)) continue;
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this]() {
+            return stopping_ || queued_.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping_ && queued_.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+void ThreadPool::TaskGroup::run(std::function<void()> task) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.push({std::move(task), this});
+}
+
+void ThreadPool::TaskGroup::wait() {
+    const size_t self = pool_.current_queue();
+    while (pending_.load(std::memory_order_acquire) != 0) {
+        if (!pool_.try_run(self)) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        std::swap(error, error_);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+ThreadPool::TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+} // namespace binsort
@@ -0,0 +1,155 @@
+#include "top_k.hpp"
+#include "async_io.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace binsort {
+
+TopK::TopK(size_t record_length, size_t limit, SortEngine& engine)
+    : record_length_(record_length)
+    , limit_(limit)
+    , engine_(engine)
+    , compare_(engine.get_comparator())
+    , stable_(engine.stable())
+    , stripes_(engine.stable() ? 1 : engine.pool().size()) {
+    if (limit_ == 0) {
+        throw std::invalid_argument("Top-K limit must be positive");
+    }
+}
+
+TopK::Stats TopK::select(const std::string& input, const std::string& output) {
+    constexpr size_t kBlockBytes = 8 * 1024 * 1024;
+    const size_t block_bytes = std::max<size_t>(1, kBlockBytes / record_length_) * record_length_;
+
+    Stats stats;
+    {
+        IOFile in(input, IOFile::Mode::Read);
+        IOBuffer block(block_bytes);
+        uint64_t size = 0;
+        while (true) {
+            const size_t n = in.read_next(block.data(), block_bytes);
+            size += n;
+            if (n % record_length_ != 0) {
+                throw std::runtime_error(
+                    "Input size (" + std::to_string(size) +
+                    ") is not divisible by record length (" +
+                    std::to_string(record_length_) + ")"
+                );
+            }
+            add(block.data(), n / record_length_);
+            if (n < block_bytes) break;
+        }
+        stats.records = added_;
+    }
+
+    stats.selected = selected_count();
+    PlacedVector<uint8_t> result(stats.selected * record_length_);
+    finish(result.data());
+
+    IOFile out(output, IOFile::Mode::Write);
+    out.write_next(result.data(), result.size());
+    return stats;
+}
+
+void TopK::add(const uint8_t* records, size_t count) {
+    added_ += count;
+    const size_t stripes = std::min(stripes_.size(), std::max<size_t>(1, count / kMinStripeRecords));
+    if (stripes == 1) {
+        add_stripe(stripes_[0], records, count);
+        return;
+    }
+    engine_.pool().parallel_for(stripes, [&](size_t s) {
+        const size_t begin = count * s / stripes;
+        const size_t end = count * (s + 1) / stripes;
+        add_stripe(stripes_[s], records + begin * record_length_, end - begin);
+    });
+}
+
+void TopK::add_stripe(Candidates& c, const uint8_t* records, size_t count) {
+    // Twice the limit halves the compactions against a buffer of limit
+    // records plus one; a limit near the input size never reaches it
+    const size_t capacity = (limit_ > std::numeric_limits<size_t>::max() / 2 / record_length_)
+        ? std::numeric_limits<size_t>::max() / record_length_
+        : 2 * limit_;
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* rec = records + i * record_length_;
+        if (!c.cutoff.empty() && compare_(rec, c.cutoff.data()) >= 0) continue;
+
+        if (c.count * record_length_ == c.records.size()) {
+            if (c.count == capacity) {
+                compact(c, limit_);
+                if (compare_(rec, c.cutoff.data()) >= 0) continue;
+            } else {
+                // Grow geometrically so small inputs stay small
+                const size_t grown = std::min(capacity, std::max<size_t>(256, 2 * c.count));
+                c.records.resize(grown * record_length_);
+            }
+        }
+        std::memcpy(c.records.data() + c.count * record_length_, rec, record_length_);
+        c.count++;
+    }
+}
+
+void TopK::compact(Candidates& c, size_t keep) {
+    if (c.count <= keep) return;
+
+    c.order.resize(c.count);
+    for (size_t i = 0; i < c.count; ++i) {
+        c.order[i] = c.records.data() + i * record_length_;
+    }
+    auto less = [this](const uint8_t* a, const uint8_t* b) { return before(a, b); };
+    std::nth_element(c.order.begin(), c.order.begin() + (keep - 1), c.order.end(), less);
+    c.cutoff.assign(c.order[keep - 1], c.order[keep - 1] + record_length_);
+
+    // In address order every kept record moves down or stays, so the
+    // buffer compacts in place without overwriting one not yet moved
+    std::sort(c.order.begin(), c.order.begin() + keep);
+    for (size_t i = 0; i < keep; ++i) {
+        uint8_t* dst = c.records.data() + i * record_length_;
+        if (c.order[i] != dst) {
+            std::memcpy(dst, c.order[i], record_length_);
+        }
+    }
+    c.count = keep;
+}
+
+bool TopK::before(const uint8_t* a, const uint8_t* b) const {
+    const int cmp = compare_(a, b);
+    return cmp < 0 || (cmp == 0 && stable_ && a < b);
+}
+
+size_t TopK::selected_count() const {
+    return std::min(limit_, added_);
+}
+
+void TopK::finish(uint8_t* output) {
+    std::vector<const uint8_t*> candidates;
+    for (Candidates& c : stripes_) {
+        compact(c, limit_);
+        for (size_t i = 0; i < c.count; ++i) {
+            candidates.push_back(c.records.data() + i * record_length_);
+        }
+    }
+
+    const size_t k = std::min(limit_, candidates.size());
+    if (k > 0 && candidates.size() > k) {
+        auto less = [this](const uint8_t* a, const uint8_t* b) { return before(a, b); };
+        std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end(), less);
+    }
+    // Buffer order is input order when stable, for the sort to preserve
+    std::sort(candidates.begin(), candidates.begin() + k);
+    for (size_t i = 0; i < k; ++i) {
+        std::memcpy(output + i * record_length_, candidates[i], record_length_);
+    }
+    engine_.sort(output, k);
+
+    for (Candidates& c : stripes_) {
+        c = Candidates();
+    }
+    added_ = 0;
+}
+
+} // namespace binsort
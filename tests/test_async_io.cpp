@@ -0,0 +1,200 @@
+// Asynchronous I/O tests
+// Multi-chunk transfers on every available backend and file copies
+
+#include "test_framework.hpp"
+#include "async_io.hpp"
+#include "file_operations.hpp"
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+using namespace binsort;
+
+namespace {
+
+std::filesystem::path temp_path(const char* name) {
+    return std::filesystem::temp_directory_path() / name;
+}
+
+std::vector<uint8_t> random_bytes(size_t size) {
+    std::mt19937 gen(5);
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) byte = static_cast<uint8_t>(gen());
+    return data;
+}
+
+std::vector<std::unique_ptr<AsyncIO>> available_backends() {
+    std::vector<std::unique_ptr<AsyncIO>> backends;
+    for (auto backend : {AsyncIO::Backend::IoUring, AsyncIO::Backend::Threads}) {
+        if (auto io = AsyncIO::create(backend, 8)) {
+            ASSERT(io->backend() == backend);
+            backends.push_back(std::move(io));
+        }
+    }
+    return backends;
+}
+
+} // namespace
+
+TEST(async_write_then_read_back) {
+    const auto path = temp_path("binsort_async_io.bin");
+    // Several chunks per transfer and more chunks than queue slots
+    const auto data = random_bytes(20 * AsyncIO::kChunkBytes + 12345);
+    const size_t half = data.size() / 2;
+
+    auto backends = available_backends();
+    ASSERT(!backends.empty());
+    for (auto& io : backends) {
+        {
+            IOFile out(path.string(), IOFile::Mode::Write);
+            const uint64_t second = io->write(out, data.data() + half, data.size() - half, half);
+            const uint64_t first = io->write(out, data.data(), half, 0);
+            io->wait(second);
+            io->wait(first);
+        }
+        ASSERT(FileOperations::get_file_size(path.string()) == data.size());
+
+        IOFile in(path.string(), IOFile::Mode::Read);
+        IOBuffer buffer(data.size());
+        io->read(in, buffer.data(), half, 0);
+        io->read(in, buffer.data() + half, data.size() - half, half);
+        io->wait_all();
+        ASSERT(std::memcmp(buffer.data(), data.data(), data.size()) == 0);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(async_read_past_end_fails) {
+    const auto path = temp_path("binsort_async_short.bin");
+    const auto data = random_bytes(1000);
+    {
+        IOFile out(path.string(), IOFile::Mode::Write);
+        out.write_at(data.data(), data.size(), 0);
+    }
+
+    for (auto& io : available_backends()) {
+        IOFile in(path.string(), IOFile::Mode::Read);
+        std::vector<uint8_t> buffer(2000);
+        ASSERT(in.read_at(buffer.data(), buffer.size(), 0) == data.size());
+
+        bool threw = false;
+        try {
+            io->wait(io->read(in, buffer.data(), buffer.size(), 0));
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        ASSERT(threw);
+        ASSERT(std::memcmp(buffer.data(), data.data(), data.size()) == 0);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(pipelined_copy_file) {
+    const auto src = temp_path("binsort_copy_src.bin");
+    const auto dst = temp_path("binsort_copy_dst.bin");
+    // The last size spans more blocks than copy_file keeps buffers
+    for (size_t size : {size_t(0), size_t(4096), size_t(50 * 1024 * 1024 + 77)}) {
+        const auto data = random_bytes(size);
+        {
+            IOFile out(src.string(), IOFile::Mode::Write);
+            out.write_at(data.data(), data.size(), 0);
+        }
+        FileOperations::copy_file(src.string(), dst.string(), size);
+
+        ASSERT(FileOperations::get_file_size(dst.string()) == size);
+        IOFile in(dst.string(), IOFile::Mode::Read);
+        std::vector<uint8_t> copy(size);
+        ASSERT(in.read_at(copy.data(), size, 0) == size);
+        ASSERT(copy == data);
+    }
+    std::filesystem::remove(src);
+    std::filesystem::remove(dst);
+}
+
+TEST(copy_file_prefix) {
+    const auto src = temp_path("binsort_copy_src.bin");
+    const auto dst = temp_path("binsort_copy_dst.bin");
+    const auto data = random_bytes(100000);
+    {
+        IOFile out(src.string(), IOFile::Mode::Write);
+        out.write_at(data.data(), data.size(), 0);
+    }
+
+    // Less than the whole file rules out a reflink
+    FileOperations::copy_file(src.string(), dst.string(), 60000);
+    ASSERT(FileOperations::get_file_size(dst.string()) == 60000);
+    IOFile in(dst.string(), IOFile::Mode::Read);
+    std::vector<uint8_t> copy(60000);
+    ASSERT(in.read_at(copy.data(), copy.size(), 0) == copy.size());
+    ASSERT(std::memcmp(copy.data(), data.data(), copy.size()) == 0);
+
+    // A source shorter than the requested size is an error
+    bool threw = false;
+    try {
+        FileOperations::copy_file(src.string(), dst.string(), data.size() + 1);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    ASSERT(threw);
+
+    std::filesystem::remove(src);
+    std::filesystem::remove(dst);
+}
+
+TEST(direct_io_padded_tail) {
+    const auto path = temp_path("binsort_async_direct.bin");
+    const auto data = random_bytes(3 * AsyncIO::kChunkBytes + 1000);
+
+    for (auto& io : available_backends()) {
+        IOBuffer buffer(data.size());
+        std::memcpy(buffer.data(), data.data(), data.size());
+        {
+            IOFile out(path.string(), IOFile::Mode::Write, true);
+            io->wait(io->write(out, buffer.data(), data.size(), 0));
+        }
+        // The padding written past the tail is trimmed on close
+        ASSERT(FileOperations::get_file_size(path.string()) == data.size());
+
+        IOBuffer copy(data.size());
+        IOFile in(path.string(), IOFile::Mode::Read, true);
+        const size_t block = 2 * IOFile::kDirectAlignment;
+        io->wait(io->read(in, copy.data(), block, 0));
+        io->wait(io->read(in, copy.data() + block, data.size() - block, block));
+        ASSERT(std::memcmp(copy.data(), data.data(), data.size()) == 0);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(placed_buffers) {
+    // Small buffers come from the heap, large ones from huge page mappings
+    IOBuffer small(100);
+    ASSERT(reinterpret_cast<uintptr_t>(small.data()) % IOBuffer::kAlignment == 0);
+    IOBuffer large(MemoryPlacement::kLargeBytes + 1);
+    ASSERT(reinterpret_cast<uintptr_t>(large.data()) % MemoryPlacement::kHugePageBytes == 0);
+    std::memset(large.data(), 0xab, large.size());
+    MemoryPlacement::advise(large.data(), large.size(), MemoryPlacement::Access::DontNeed);
+
+    PlacedVector<uint64_t> values(MemoryPlacement::kLargeBytes / 8 * 3);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = i;
+    values.resize(10);
+    values.shrink_to_fit();
+    ASSERT(values[9] == 9);
+    ASSERT(MemoryPlacement::node_count() >= 1);
+
+    // Opting into hugetlbfs falls back when no pages are reserved
+    MemoryPlacement::set_explicit_huge_pages(true);
+    IOBuffer pooled(MemoryPlacement::kLargeBytes);
+    MemoryPlacement::set_explicit_huge_pages(false);
+    ASSERT(reinterpret_cast<uintptr_t>(pooled.data()) % MemoryPlacement::kHugePageBytes == 0);
+    std::memset(pooled.data(), 0xcd, pooled.size());
+}
+
+void run_async_io_tests() {
+    RUN_TEST(async_write_then_read_back);
+    RUN_TEST(async_read_past_end_fails);
+    RUN_TEST(pipelined_copy_file);
+    RUN_TEST(copy_file_prefix);
+    RUN_TEST(direct_io_padded_tail);
+    RUN_TEST(placed_buffers);
+}
@@ -1,2 +1,173 @@
-// Placeholder for comparison function tests
-// These will test the JIT-generated comparison functions
+// Comparison function tests
+// Checks the JIT-generated and interpreted comparators against RecordComparator
+
+#include "test_framework.hpp"
+#include "comparison_generator.hpp"
+#include "code_arena.hpp"
+#include "record.hpp"
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace binsort;
+
+namespace {
+
+int sign(int v) { return (v > 0) - (v < 0); }
+
+// Random records with a small value range so that keys collide often and
+// later keys in a compound spec actually get exercised
+std::vector<uint8_t> make_records(size_t record_length, size_t count, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> pick(0, 3);
+    std::vector<uint8_t> data(record_length * count);
+    for (auto& byte : data) {
+        static const uint8_t values[] = {0x00, 0x01, 0x80, 0xff};
+        byte = values[pick(gen)];
+    }
+    return data;
+}
+
+void check_against_reference(Comparator compare, const std::vector<KeySpec>& keys, size_t record_length) {
+    RecordComparator reference(keys);
+
+    const size_t count = 64;
+    auto data = make_records(record_length, count, 1234);
+
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < count; ++j) {
+            const uint8_t* a = data.data() + i * record_length;
+            const uint8_t* b = data.data() + j * record_length;
+            int expected = sign(reference.compare(
+                RecordView(a, record_length), RecordView(b, record_length)));
+            ASSERT(sign(compare(a, b)) == expected);
+        }
+    }
+}
+
+// Check both the generated and the interpreted comparator
+void check_against_reference(const std::vector<KeySpec>& keys, size_t record_length) {
+    ComparisonFunc func = ComparisonGenerator::generate(keys, record_length);
+    ASSERT(func != nullptr);
+    check_against_reference({func, nullptr}, keys, record_length);
+    ComparisonGenerator::free_function(func);
+
+    InterpretedComparator interpreter(keys);
+    check_against_reference(interpreter.bind(), keys, record_length);
+}
+
+} // namespace
+
+TEST(jit_integer_keys) {
+    for (KeyType type : {KeyType::LittleEndianInt, KeyType::BigEndianInt}) {
+        for (size_t len : {2, 4, 8}) {
+            for (SortOrder order : {SortOrder::Ascending, SortOrder::Descending}) {
+                check_against_reference({{3, len, type, order}}, 16);
+            }
+        }
+    }
+}
+
+TEST(jit_float_keys) {
+    for (size_t len : {2, 4, 8}) {
+        for (SortOrder order : {SortOrder::Ascending, SortOrder::Descending}) {
+            check_against_reference({{1, len, KeyType::LittleEndianFloat, order}}, 8);
+        }
+    }
+}
+
+TEST(jit_float_total_order) {
+    std::vector<KeySpec> keys = {{1, 8, KeyType::LittleEndianFloat, SortOrder::Ascending}};
+    ComparisonFunc func = ComparisonGenerator::generate(keys, 8);
+
+    const double values[] = {-1e300, -2.5, -0.0, 0.0, 1e-300, 3.0, 1e300};
+    for (size_t i = 0; i + 1 < std::size(values); ++i) {
+        uint8_t a[8], b[8];
+        std::memcpy(a, &values[i], 8);
+        std::memcpy(b, &values[i + 1], 8);
+        ASSERT(func(a, b, nullptr) < 0);
+        ASSERT(func(b, a, nullptr) > 0);
+        ASSERT(func(a, a, nullptr) == 0);
+    }
+
+    ComparisonGenerator::free_function(func);
+}
+
+TEST(jit_character_keys) {
+    for (size_t len : {1, 3, 7, 8, 15, 300}) {
+        for (SortOrder order : {SortOrder::Ascending, SortOrder::Descending}) {
+            check_against_reference({{2, len, KeyType::Character, order}}, 320);
+        }
+    }
+}
+
+TEST(jit_multi_key) {
+    check_against_reference({
+        {1, 4, KeyType::LittleEndianInt, SortOrder::Ascending},
+        {5, 2, KeyType::BigEndianInt, SortOrder::Descending},
+        {7, 3, KeyType::Character, SortOrder::Ascending},
+        {10, 4, KeyType::LittleEndianFloat, SortOrder::Descending},
+        {14, 8, KeyType::BigEndianInt, SortOrder::Ascending},
+    }, 200);
+}
+
+TEST(interpreted_comparators_are_independent) {
+    // Two layouts alive at once must not see each other's keys
+    InterpretedComparator by_first({{1, 4, KeyType::LittleEndianInt, SortOrder::Ascending}});
+    InterpretedComparator by_second({
+        {5, 4, KeyType::LittleEndianInt, SortOrder::Ascending},
+        {1, 1, KeyType::Character, SortOrder::Ascending},
+    });
+    Comparator first = by_first.bind();
+    Comparator second = by_second.bind();
+
+    uint8_t a[8] = {1, 0, 0, 0, 9, 0, 0, 0};
+    uint8_t b[8] = {2, 0, 0, 0, 3, 0, 0, 0};
+    ASSERT(first(a, b) < 0);
+    ASSERT(second(a, b) > 0);
+    ASSERT(first(b, a) > 0);
+    ASSERT(second(b, a) < 0);
+}
+
+TEST(jit_cache_reuses_code) {
+    std::vector<KeySpec> keys = {{1, 4, KeyType::LittleEndianInt, SortOrder::Ascending}};
+    ComparisonFunc first = ComparisonGenerator::generate(keys, 24);
+    ComparisonFunc second = ComparisonGenerator::generate(keys, 24);
+    ASSERT(first == second);
+    ASSERT(CodeArena::instance().size_of(reinterpret_cast<void*>(first)) > 0);
+
+    // Same keys, different record length: separate function
+    ComparisonFunc other = ComparisonGenerator::generate(keys, 32);
+    ASSERT(other != first);
+
+    ComparisonGenerator::free_function(first);
+    ComparisonGenerator::free_function(second);
+    ComparisonGenerator::free_function(other);
+
+    // Idle code stays installed for the next sort with the same layout
+    ComparisonFunc again = ComparisonGenerator::generate(keys, 24);
+    ASSERT(again == first);
+    ComparisonGenerator::free_function(again);
+}
+
+TEST(jit_cache_evicts_idle_code) {
+    const size_t before = CodeArena::instance().mapped_bytes();
+    for (size_t length = 100; length < 100 + 4 * ComparisonGenerator::kMaxIdleFunctions; ++length) {
+        ComparisonFunc func = ComparisonGenerator::generate(
+            {{1, 8, KeyType::BigEndianInt, SortOrder::Descending}}, length);
+        ComparisonGenerator::free_function(func);
+    }
+    // Many small comparators share a chunk; idle ones beyond the limit are freed
+    ASSERT(CodeArena::instance().mapped_bytes() <= before + 64 * 1024);
+}
+
+void run_comparison_tests() {
+    RUN_TEST(jit_integer_keys);
+    RUN_TEST(jit_float_keys);
+    RUN_TEST(jit_float_total_order);
+    RUN_TEST(jit_character_keys);
+    RUN_TEST(jit_multi_key);
+    RUN_TEST(interpreted_comparators_are_independent);
+    RUN_TEST(jit_cache_reuses_code);
+    RUN_TEST(jit_cache_evicts_idle_code);
+}
@@ -1,2 +1,93 @@
-// Placeholder for endianness tests
-// These will test the byte-swapping functions for different endianness
+// Endianness tests
+// Checks the byte swapping done by the normalized key encoding
+
+#include "test_framework.hpp"
+#include "comparison_generator.hpp"
+#include "key_normalizer.hpp"
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace binsort;
+
+namespace {
+
+int sign(int v) { return (v > 0) - (v < 0); }
+
+void check_normalized_order(const std::vector<KeySpec>& keys, size_t record_length) {
+    KeyNormalizer normalizer(keys);
+    InterpretedComparator reference(keys);
+
+    std::mt19937 gen(99);
+    std::vector<uint8_t> a(record_length), b(record_length);
+    std::vector<uint8_t> na(normalizer.key_width()), nb(normalizer.key_width());
+
+    for (int i = 0; i < 5000; ++i) {
+        // Few distinct byte values so that keys tie and signs vary
+        for (auto& byte : a) byte = static_cast<uint8_t>(gen() % 3 * 0x7f);
+        for (auto& byte : b) byte = static_cast<uint8_t>(gen() % 3 * 0x7f);
+
+        normalizer.normalize(a.data(), na.data());
+        normalizer.normalize(b.data(), nb.data());
+        const int expected = sign(reference.compare(a.data(), b.data()));
+
+        ASSERT(sign(std::memcmp(na.data(), nb.data(), na.size())) == expected);
+
+        const uint64_t pa = normalizer.prefix(a.data());
+        const uint64_t pb = normalizer.prefix(b.data());
+        if (pa != pb) {
+            ASSERT((pa < pb) == (expected < 0));
+        } else if (normalizer.prefix_is_exact()) {
+            ASSERT(expected == 0);
+        }
+    }
+}
+
+} // namespace
+
+TEST(normalized_integer_bytes) {
+    const uint8_t record[] = {0x04, 0x03, 0x02, 0x01, 0xff, 0xfe};
+
+    KeyNormalizer little({{1, 4, KeyType::LittleEndianInt, SortOrder::Ascending}});
+    uint8_t out[4];
+    little.normalize(record, out);
+    const uint8_t expected_little[] = {0x81, 0x02, 0x03, 0x04};
+    ASSERT(std::memcmp(out, expected_little, 4) == 0);
+
+    KeyNormalizer big({{5, 2, KeyType::BigEndianInt, SortOrder::Descending}});
+    big.normalize(record, out);
+    // 0xfffe is -2: sign flip gives 0x7ffe, descending inverts it
+    ASSERT(out[0] == 0x80 && out[1] == 0x01);
+}
+
+TEST(normalized_single_keys) {
+    for (KeyType type : {KeyType::LittleEndianInt, KeyType::BigEndianInt, KeyType::LittleEndianFloat}) {
+        for (size_t len : {2, 4, 8}) {
+            for (SortOrder order : {SortOrder::Ascending, SortOrder::Descending}) {
+                check_normalized_order({{2, len, type, order}}, 12);
+            }
+        }
+    }
+    for (SortOrder order : {SortOrder::Ascending, SortOrder::Descending}) {
+        check_normalized_order({{1, 11, KeyType::Character, order}}, 12);
+    }
+}
+
+TEST(normalized_compound_keys) {
+    check_normalized_order({
+        {1, 2, KeyType::LittleEndianInt, SortOrder::Descending},
+        {3, 3, KeyType::Character, SortOrder::Ascending},
+        {6, 8, KeyType::LittleEndianFloat, SortOrder::Ascending},
+        {14, 4, KeyType::BigEndianInt, SortOrder::Descending},
+    }, 20);
+    check_normalized_order({
+        {1, 4, KeyType::LittleEndianInt, SortOrder::Ascending},
+        {5, 4, KeyType::LittleEndianInt, SortOrder::Ascending},
+    }, 16);
+}
+
+void run_endianness_tests() {
+    RUN_TEST(normalized_integer_bytes);
+    RUN_TEST(normalized_single_keys);
+    RUN_TEST(normalized_compound_keys);
+}
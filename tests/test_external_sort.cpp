@@ -0,0 +1,416 @@
+// External sort tests
+// Sorts files through spilled runs under small memory budgets
+
+#include "test_framework.hpp"
+#include "external_sort.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/stat.h>
+#endif
+
+using namespace binsort;
+
+namespace {
+
+const std::vector<KeySpec> kKeys = {
+    {1, 4, KeyType::LittleEndianInt, SortOrder::Ascending},
+};
+
+constexpr size_t kRecordLength = 16;
+
+std::filesystem::path temp_dir() {
+    return std::filesystem::temp_directory_path();
+}
+
+// Key at offset 0 with few distinct values, sequence number at offset 8
+std::vector<uint8_t> make_records(size_t count) {
+    std::mt19937 gen(11);
+    std::vector<uint8_t> data(count * kRecordLength, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const int32_t key = static_cast<int32_t>(gen() % 1000) - 500;
+        const uint64_t seq = i;
+        std::memcpy(data.data() + i * kRecordLength, &key, 4);
+        std::memcpy(data.data() + i * kRecordLength + 8, &seq, 8);
+    }
+    return data;
+}
+
+void write_bytes(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+std::vector<uint8_t> read_bytes(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+
+// Keys in order and every sequence number present once
+void check_sorted(const std::vector<uint8_t>& input, const std::vector<uint8_t>& output) {
+    ASSERT(input.size() == output.size());
+    const size_t count = input.size() / kRecordLength;
+
+    std::vector<uint64_t> seen;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* rec = output.data() + i * kRecordLength;
+        if (i > 0) {
+            int32_t prev, curr;
+            std::memcpy(&prev, rec - kRecordLength, 4);
+            std::memcpy(&curr, rec, 4);
+            ASSERT(prev <= curr);
+        }
+        uint64_t seq;
+        std::memcpy(&seq, rec + 8, 8);
+        ASSERT(seq < count);
+        ASSERT(std::memcmp(rec, input.data() + seq * kRecordLength, kRecordLength) == 0);
+        seen.push_back(seq);
+    }
+    std::sort(seen.begin(), seen.end());
+    ASSERT(std::adjacent_find(seen.begin(), seen.end()) == seen.end());
+}
+
+ExternalSort::Stats external_sort(const std::filesystem::path& input, const std::filesystem::path& output,
+                                  size_t budget, size_t merge_buffer, bool direct = false,
+                                  bool stable = false, const GroupReducer::Config& groups = {}) {
+    SortEngine::Config engine_config;
+    engine_config.record_length = kRecordLength;
+    engine_config.thread_count = 2;
+    engine_config.keys = kKeys;
+    engine_config.stable = stable;
+    SortEngine engine(engine_config);
+
+    ExternalSort::Config config;
+    config.record_length = kRecordLength;
+    config.memory_budget = budget;
+    config.temp_directory = temp_dir().string();
+    config.min_merge_buffer = merge_buffer;
+    config.direct_io = direct;
+    config.groups = groups;
+
+    ExternalSort sorter(config, engine);
+    return sorter.sort(input.string(), output.string());
+}
+
+size_t leftover_runs() {
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(temp_dir())) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("binsort-", 0) == 0 && entry.path().extension() == ".run") ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(external_single_pass_merge) {
+    const auto input = temp_dir() / "binsort_ext_in.bin";
+    const auto output = temp_dir() / "binsort_ext_out.bin";
+    const auto data = make_records(20000);
+    write_bytes(input, data);
+    const size_t runs_before = leftover_runs();
+
+    // 64 KiB budget: runs of 1024 records, all merged at once
+    auto stats = external_sort(input, output, 64 * 1024, 1024);
+    ASSERT(stats.runs == 20);
+    ASSERT(stats.merge_passes == 1);
+    check_sorted(data, read_bytes(output));
+    ASSERT(leftover_runs() == runs_before);
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+
+TEST(external_multi_pass_merge) {
+    const auto input = temp_dir() / "binsort_ext_in.bin";
+    const auto output = temp_dir() / "binsort_ext_out.bin";
+    const auto data = make_records(30001);
+    write_bytes(input, data);
+
+    // Fan-in of 3 over 59 runs needs several passes
+    auto stats = external_sort(input, output, 32 * 1024, 8 * 1024);
+    ASSERT(stats.runs == 59);
+    ASSERT(stats.merge_passes == 4);
+    check_sorted(data, read_bytes(output));
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+
+#ifndef _WIN32
+TEST(external_fan_in_below_open_file_limit) {
+    const auto input = temp_dir() / "binsort_ext_in.bin";
+    const auto output = temp_dir() / "binsort_ext_out.bin";
+    const auto data = make_records(20000);
+    write_bytes(input, data);
+
+    // The budget allows all 20 runs at once, but 80 descriptors less the
+    // 64 held back leave a fan-in of 15
+    struct rlimit saved;
+    ASSERT(getrlimit(RLIMIT_NOFILE, &saved) == 0);
+    struct rlimit lowered = saved;
+    lowered.rlim_cur = 80;
+    ASSERT(setrlimit(RLIMIT_NOFILE, &lowered) == 0);
+    auto stats = external_sort(input, output, 64 * 1024, 1024);
+    setrlimit(RLIMIT_NOFILE, &saved);
+
+    ASSERT(stats.runs == 20);
+    ASSERT(stats.merge_passes == 2);
+    check_sorted(data, read_bytes(output));
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+#endif
+
+TEST(external_stable_multi_pass) {
+    const auto input = temp_dir() / "binsort_ext_in.bin";
+    const auto output = temp_dir() / "binsort_ext_out.bin";
+    const auto data = make_records(30001);
+    write_bytes(input, data);
+
+    // Stable runs merged over several passes keep equal keys in input order
+    auto stats = external_sort(input, output, 32 * 1024, 8 * 1024, false, true);
+    ASSERT(stats.merge_passes == 4);
+    const auto result = read_bytes(output);
+    check_sorted(data, result);
+    for (size_t i = 1; i < result.size() / kRecordLength; ++i) {
+        const uint8_t* rec = result.data() + i * kRecordLength;
+        if (std::memcmp(rec - kRecordLength, rec, 4) == 0) {
+            uint64_t prev, curr;
+            std::memcpy(&prev, rec - kRecordLength + 8, 8);
+            std::memcpy(&curr, rec + 8, 8);
+            ASSERT(prev < curr);
+        }
+    }
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+
+// One record per key: the first or last of its group in input order, with
+// the group size in a 4-byte field at offset 4
+void check_groups(const std::vector<uint8_t>& input, const std::vector<uint8_t>& output, bool last) {
+    struct Group { uint64_t seq; uint32_t size; };
+    std::map<int32_t, Group> expected;
+    for (size_t i = 0; i < input.size() / kRecordLength; ++i) {
+        int32_t key;
+        std::memcpy(&key, input.data() + i * kRecordLength, 4);
+        auto [it, inserted] = expected.try_emplace(key, Group{i, 0});
+        if (last) it->second.seq = i;
+        it->second.size++;
+    }
+
+    ASSERT(output.size() == expected.size() * kRecordLength);
+    size_t i = 0;
+    for (const auto& [key, group] : expected) {
+        const uint8_t* rec = output.data() + i++ * kRecordLength;
+        int32_t out_key;
+        uint32_t size;
+        uint64_t seq;
+        std::memcpy(&out_key, rec, 4);
+        std::memcpy(&size, rec + 4, 4);
+        std::memcpy(&seq, rec + 8, 8);
+        ASSERT(out_key == key);
+        ASSERT(size == group.size);
+        ASSERT(seq == group.seq);
+    }
+}
+
+TEST(group_reducer_in_place) {
+    const std::vector<uint8_t> input = make_records(5000);
+    auto sorted = input;
+    SortEngine::Config engine_config;
+    engine_config.record_length = kRecordLength;
+    engine_config.thread_count = 2;
+    engine_config.keys = kKeys;
+    engine_config.stable = true;
+    SortEngine engine(engine_config);
+    engine.sort(sorted.data(), 5000);
+
+    for (bool last : {false, true}) {
+        GroupReducer::Config config;
+        config.duplicates = last ? DuplicateMode::KeepLast : DuplicateMode::KeepAll;
+        config.count_offset = 4;
+        config.count_length = 4;
+        GroupReducer groups(kRecordLength, engine.get_comparator(), config);
+
+        auto data = sorted;
+        const size_t kept = groups.reduce(data.data(), 5000);
+        data.resize(kept * kRecordLength);
+        check_groups(input, data, last);
+    }
+
+    // No reduction configured: everything is kept
+    GroupReducer none(kRecordLength, engine.get_comparator(), {});
+    auto data = sorted;
+    ASSERT(none.reduce(data.data(), 5000) == 5000);
+    ASSERT(data == sorted);
+}
+
+TEST(external_unique_and_count) {
+    const auto input = temp_dir() / "binsort_ext_in.bin";
+    const auto output = temp_dir() / "binsort_ext_out.bin";
+
+    // A single run and several merge passes reduce the same way
+    for (size_t count : {1000, 30001}) {
+        const auto data = make_records(count);
+        write_bytes(input, data);
+        for (bool last : {false, true}) {
+            GroupReducer::Config groups;
+            groups.duplicates = last ? DuplicateMode::KeepLast : DuplicateMode::KeepFirst;
+            groups.count_offset = 4;
+            groups.count_length = 4;
+            auto stats = external_sort(input, output, 32 * 1024, 8 * 1024, false, true, groups);
+            const auto result = read_bytes(output);
+            ASSERT(stats.output_records * kRecordLength == result.size());
+            check_groups(data, result, last);
+        }
+    }
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+
+TEST(external_merge_sorted_inputs) {
+    SortEngine::Config engine_config;
+    engine_config.record_length = kRecordLength;
+    engine_config.thread_count = 2;
+    engine_config.keys = kKeys;
+    engine_config.stable = true;
+    SortEngine engine(engine_config);
+
+    // Seven sorted inputs of different sizes, one empty
+    std::vector<std::string> inputs;
+    std::vector<uint8_t> all;
+    for (size_t i = 0; i < 7; ++i) {
+        auto data = make_records(i == 3 ? 0 : 1000 + 1500 * i);
+        engine.sort(data.data(), data.size() / kRecordLength);
+        const auto path = temp_dir() / ("binsort_merge_in" + std::to_string(i) + ".bin");
+        write_bytes(path, data);
+        inputs.push_back(path.string());
+        all.insert(all.end(), data.begin(), data.end());
+    }
+    // A stable sort of the concatenation takes equal keys from earlier
+    // inputs first, as the merge must
+    engine.sort(all.data(), all.size() / kRecordLength);
+
+    const auto output = temp_dir() / "binsort_merge_out.bin";
+    for (size_t budget : {32 * 1024, 1024 * 1024}) {
+        ExternalSort::Config config;
+        config.record_length = kRecordLength;
+        config.memory_budget = budget;
+        config.temp_directory = temp_dir().string();
+        config.min_merge_buffer = 8 * 1024;
+        ExternalSort merger(config, engine);
+        auto stats = merger.merge(inputs, output.string());
+        ASSERT(stats.merge_passes == (budget < 64 * 1024 ? 2 : 1));
+        ASSERT(stats.output_records * kRecordLength == all.size());
+        ASSERT(read_bytes(output) == all);
+        for (const auto& input : inputs) {
+            ASSERT(std::filesystem::exists(input));
+        }
+    }
+
+    // Out-of-order input is reported rather than merged
+    auto unsorted = make_records(5000);
+    write_bytes(inputs[1], unsorted);
+    ExternalSort::Config config;
+    config.record_length = kRecordLength;
+    config.memory_budget = 1024 * 1024;
+    config.temp_directory = temp_dir().string();
+    ExternalSort merger(config, engine);
+    bool rejected = false;
+    try {
+        merger.merge(inputs, output.string());
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    ASSERT(rejected);
+
+    for (const auto& input : inputs) std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+
+TEST(external_in_place_and_small_inputs) {
+    const auto path = temp_dir() / "binsort_ext_inplace.bin";
+    for (size_t count : {0, 1, 100, 5000}) {
+        const auto data = make_records(count);
+        write_bytes(path, data);
+        auto stats = external_sort(path, path, 16 * 1024, 1024);
+        ASSERT(stats.runs == (count * kRecordLength > 4 * 1024 ? (count + 255) / 256 : 0));
+        check_sorted(data, read_bytes(path));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(external_direct_io) {
+    const auto input = temp_dir() / "binsort_ext_in.bin";
+    const auto output = temp_dir() / "binsort_ext_out.bin";
+    // Not a whole number of 4 KiB blocks, so every file has a padded tail
+    const auto data = make_records(20003);
+    write_bytes(input, data);
+
+    // Runs of 1024 records start on block boundaries; 3 runs per merge
+    auto stats = external_sort(input, output, 64 * 1024, 16 * 1024, true);
+    ASSERT(stats.runs == 20);
+    ASSERT(stats.merge_passes == 3);
+    check_sorted(data, read_bytes(output));
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+
+#ifndef _WIN32
+TEST(external_named_pipes) {
+    const auto input = temp_dir() / "binsort_ext_in.fifo";
+    const auto output = temp_dir() / "binsort_ext_out.fifo";
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+    ASSERT(mkfifo(input.c_str(), 0600) == 0);
+    ASSERT(mkfifo(output.c_str(), 0600) == 0);
+
+    // Both ends are pipes: the input is read until the writer closes it
+    // and the result is streamed out by the final merge
+    for (size_t count : {0, 300, 20000}) {
+        const auto data = make_records(count);
+        std::vector<uint8_t> result;
+        std::thread writer([&]() { write_bytes(input, data); });
+        std::thread reader([&]() { result = read_bytes(output); });
+
+        auto stats = external_sort(input, output, 64 * 1024, 4 * 1024);
+        writer.join();
+        reader.join();
+        ASSERT(stats.runs == (count > 1024 ? 20 : 0));
+        check_sorted(data, result);
+    }
+
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+#endif
+
+void run_external_sort_tests() {
+    RUN_TEST(external_single_pass_merge);
+    RUN_TEST(external_multi_pass_merge);
+#ifndef _WIN32
+    RUN_TEST(external_fan_in_below_open_file_limit);
+#endif
+    RUN_TEST(external_stable_multi_pass);
+    RUN_TEST(group_reducer_in_place);
+    RUN_TEST(external_unique_and_count);
+    RUN_TEST(external_merge_sorted_inputs);
+    RUN_TEST(external_in_place_and_small_inputs);
+    RUN_TEST(external_direct_io);
+#ifndef _WIN32
+    RUN_TEST(external_named_pipes);
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <iostream>
+#include <stdexcept>
+
+// Simple test framework
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+// Test groups, one per test file
+void run_endianness_tests();
+void run_comparison_tests();
+void run_sort_engine_tests();
+void run_thread_pool_tests();
+void run_external_sort_tests();
+void run_async_io_tests();
@@ -1,26 +1,18 @@
+#include "test_framework.hpp"
 #include <iostream>
 #include <cstring>
 
-// Simple test framework
-#define TEST(name) void test_##name()
-#define RUN_TEST(name) do { \
-    std::cout << "Running " #name "..."; \
-    test_##name(); \
-    std::cout << " PASSED\n"; \
-} while(0)
-
-#define ASSERT(condition) do { \
-    if (!(condition)) { \
-        throw std::runtime_error("Assertion failed: " #condition); \
-    } \
-} while(0)
-
 int main() {
     std::cout << "Binary Sort Test Suite\n";
     std::cout << "======================\n\n";
     
     try {
-        // Tests will be added in other files
+        run_endianness_tests();
+        run_comparison_tests();
+        run_sort_engine_tests();
+        run_thread_pool_tests();
+        run_external_sort_tests();
+        run_async_io_tests();
         std::cout << "\nAll tests passed!\n";
         return 0;
     }
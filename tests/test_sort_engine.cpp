@@ -0,0 +1,532 @@
+// Sort engine tests
+// Sorts generated inputs with known patterns and checks order and contents
+
+#include "test_framework.hpp"
+#include "sort_engine.hpp"
+#include "sample_sort.hpp"
+#include "simd_kernels.hpp"
+#include "specialized_layouts.hpp"
+#include "top_k.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace binsort;
+
+namespace {
+
+const std::vector<KeySpec> kTwoKeys = {
+    {1, 4, KeyType::LittleEndianInt, SortOrder::Ascending},
+    {5, 4, KeyType::LittleEndianInt, SortOrder::Descending},
+};
+
+enum class Pattern {
+    Random, Sorted, Reversed, AllEqual, FewDistinct, OrganPipe,
+    SortedWithTail, FewRuns, DescendingTies
+};
+
+// Records: key1 at offset 0, key2 at offset 4, sequence number at offset 8
+std::vector<uint8_t> make_input(Pattern pattern, size_t count, size_t record_length) {
+    std::mt19937 gen(42);
+    std::vector<uint8_t> data(count * record_length, 0);
+    for (size_t i = 0; i < count; ++i) {
+        int32_t key1 = 0;
+        int32_t key2 = static_cast<int32_t>(gen() % 8);
+        switch (pattern) {
+            case Pattern::Random:      key1 = static_cast<int32_t>(gen()); break;
+            case Pattern::Sorted:      key1 = static_cast<int32_t>(i); break;
+            case Pattern::Reversed:    key1 = static_cast<int32_t>(count - i); break;
+            case Pattern::AllEqual:    key1 = 7; key2 = 7; break;
+            case Pattern::FewDistinct: key1 = static_cast<int32_t>(gen() % 4); break;
+            case Pattern::OrganPipe:   key1 = static_cast<int32_t>(i < count / 2 ? i : count - i); break;
+            case Pattern::SortedWithTail:
+                key1 = static_cast<int32_t>(i < count - count / 20 ? i : gen() % count);
+                break;
+            case Pattern::FewRuns:     key1 = static_cast<int32_t>(i % (count / 5 + 1)); break;
+            case Pattern::DescendingTies: key1 = static_cast<int32_t>((count - i) / 8); key2 = 7; break;
+        }
+        uint8_t* rec = data.data() + i * record_length;
+        uint64_t seq = i;
+        std::memcpy(rec, &key1, 4);
+        std::memcpy(rec + 4, &key2, 4);
+        std::memcpy(rec + 8, &seq, 8);
+    }
+    return data;
+}
+
+// Order check plus a permutation check on the sequence numbers
+void check_sorted(const std::vector<uint8_t>& data, size_t record_length, size_t count,
+                  const std::vector<KeySpec>& keys = kTwoKeys) {
+    InterpretedComparator reference(keys);
+    std::vector<uint64_t> seen;
+    seen.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* rec = data.data() + i * record_length;
+        if (i > 0) {
+            ASSERT(reference.compare(rec - record_length, rec) <= 0);
+        }
+        uint64_t seq;
+        std::memcpy(&seq, rec + 8, 8);
+        seen.push_back(seq);
+    }
+    std::sort(seen.begin(), seen.end());
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT(seen[i] == i);
+    }
+}
+
+void sort_and_check(Pattern pattern, size_t count, size_t record_length, size_t threads,
+                    SortAlgorithm algorithm = SortAlgorithm::QuickSort,
+                    bool out_of_place = false) {
+    auto data = make_input(pattern, count, record_length);
+
+    SortEngine::Config config;
+    config.record_length = record_length;
+    config.thread_count = threads;
+    config.keys = kTwoKeys;
+    config.algorithm = algorithm;
+    SortEngine engine(config);
+
+    if (out_of_place) {
+        std::vector<uint8_t> output(data.size());
+        engine.sort(data.data(), output.data(), count);
+        check_sorted(output, record_length, count);
+    } else {
+        engine.sort(data.data(), count);
+        check_sorted(data, record_length, count);
+    }
+}
+
+// Equal keys must keep ascending sequence numbers
+void check_stable(const std::vector<uint8_t>& data, size_t record_length, size_t count) {
+    InterpretedComparator reference(kTwoKeys);
+    for (size_t i = 1; i < count; ++i) {
+        const uint8_t* rec = data.data() + i * record_length;
+        if (reference.compare(rec - record_length, rec) == 0) {
+            uint64_t prev, curr;
+            std::memcpy(&prev, rec - record_length + 8, 8);
+            std::memcpy(&curr, rec + 8, 8);
+            ASSERT(prev < curr);
+        }
+    }
+}
+
+const Pattern kPatterns[] = {
+    Pattern::Random, Pattern::Sorted, Pattern::Reversed,
+    Pattern::AllEqual, Pattern::FewDistinct, Pattern::OrganPipe,
+};
+
+} // namespace
+
+TEST(quicksort_patterns) {
+    for (Pattern pattern : kPatterns) {
+        for (size_t count : {0, 1, 2, 23, 24, 129, 5000, 100000}) {
+            sort_and_check(pattern, count, 16, 1);
+        }
+    }
+}
+
+TEST(parallel_quicksort_patterns) {
+    // Large enough for the sample sort
+    for (Pattern pattern : kPatterns) {
+        for (size_t threads : {2, 5}) {
+            sort_and_check(pattern, 300000, 16, threads);
+            sort_and_check(pattern, 300000, 16, threads, SortAlgorithm::QuickSort, true);
+        }
+    }
+}
+
+TEST(sample_sort_record_sizes) {
+    // Block sizes that do not divide the input, blocks of a single record
+    // and buckets with no full blocks all take different distribution paths
+    ThreadPool pool(3);
+    InterpretedComparator reference(kTwoKeys);
+    for (Pattern pattern : kPatterns) {
+        for (size_t record_length : {16, 24, 100, 3000}) {
+            for (size_t count : {2, 777, 12345}) {
+                if (record_length == 3000 && count > 1000) continue;
+                auto data = make_input(pattern, count, record_length);
+                std::vector<uint8_t> output(data.size());
+
+                SampleSort out_of_place(record_length, reference.bind(), pool);
+                out_of_place.sort(data.data(), output.data(), count);
+                check_sorted(output, record_length, count);
+
+                SampleSort in_place(record_length, reference.bind(), pool);
+                in_place.sort(data.data(), count);
+                check_sorted(data, record_length, count);
+            }
+        }
+    }
+}
+
+TEST(quicksort_wide_records) {
+    for (Pattern pattern : kPatterns) {
+        sort_and_check(pattern, 3000, 300, 1);
+    }
+}
+
+TEST(parallel_sort_patterns) {
+    for (Pattern pattern : kPatterns) {
+        sort_and_check(pattern, 50000, 16, 4);
+    }
+}
+
+TEST(parallel_wide_records) {
+    for (Pattern pattern : kPatterns) {
+        sort_and_check(pattern, 10000, 2048, 4);
+        sort_and_check(pattern, 9001, 2048, 3);
+    }
+}
+
+TEST(shared_pool_across_engines) {
+    // Many small sorts on one pool, as when sorting many files
+    auto pool = std::make_shared<ThreadPool>(4);
+    for (Pattern pattern : kPatterns) {
+        for (SortAlgorithm algorithm : {SortAlgorithm::QuickSort, SortAlgorithm::KeyIndex, SortAlgorithm::Radix}) {
+            for (size_t count : {100, 70000}) {
+                auto data = make_input(pattern, count, 16);
+                SortEngine::Config config;
+                config.record_length = 16;
+                config.keys = kTwoKeys;
+                config.algorithm = algorithm;
+                config.pool = pool;
+                SortEngine engine(config);
+                engine.sort(data.data(), count);
+                check_sorted(data, 16, count);
+            }
+        }
+    }
+}
+
+TEST(out_of_place_sort) {
+    for (Pattern pattern : kPatterns) {
+        for (size_t threads : {1, 4}) {
+            for (size_t count : {0, 1, 2, 5000, 50000}) {
+                sort_and_check(pattern, count, 16, threads, SortAlgorithm::QuickSort, true);
+                sort_and_check(pattern, count, 16, threads, SortAlgorithm::KeyIndex, true);
+                sort_and_check(pattern, count, 16, threads, SortAlgorithm::Radix, true);
+            }
+            sort_and_check(pattern, 3000, 300, threads, SortAlgorithm::KeyIndex, true);
+            sort_and_check(pattern, 3000, 300, threads, SortAlgorithm::Radix, true);
+        }
+    }
+}
+
+TEST(key_index_patterns) {
+    for (Pattern pattern : kPatterns) {
+        for (size_t threads : {1, 4}) {
+            sort_and_check(pattern, 20000, 16, threads, SortAlgorithm::KeyIndex);
+            sort_and_check(pattern, 3000, 300, threads, SortAlgorithm::KeyIndex);
+        }
+    }
+}
+
+TEST(radix_patterns) {
+    for (Pattern pattern : kPatterns) {
+        for (size_t threads : {1, 4}) {
+            sort_and_check(pattern, 60000, 16, threads, SortAlgorithm::Radix);
+            sort_and_check(pattern, 3000, 300, threads, SortAlgorithm::Radix);
+        }
+    }
+}
+
+TEST(radix_float_keys) {
+    // Float keys are not byte-local and take the normalizing digit path
+    const std::vector<KeySpec> keys = {
+        {1, 4, KeyType::LittleEndianFloat, SortOrder::Descending},
+        {5, 2, KeyType::BigEndianInt, SortOrder::Ascending},
+    };
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+    const size_t count = 40000;
+    std::vector<uint8_t> data(count * 8);
+    for (size_t i = 0; i < count; ++i) {
+        const float value = (i % 7 == 0) ? 0.5f : dist(gen);
+        std::memcpy(data.data() + i * 8, &value, 4);
+        const uint32_t rest = static_cast<uint32_t>(gen());
+        std::memcpy(data.data() + i * 8 + 4, &rest, 4);
+    }
+
+    SortEngine::Config config;
+    config.record_length = 8;
+    config.thread_count = 3;
+    config.keys = keys;
+    config.algorithm = SortAlgorithm::Radix;
+    SortEngine engine(config);
+    engine.sort(data.data(), count);
+
+    InterpretedComparator reference(keys);
+    for (size_t i = 1; i < count; ++i) {
+        ASSERT(reference.compare(data.data() + (i - 1) * 8, data.data() + i * 8) <= 0);
+    }
+}
+
+TEST(stable_sort_keeps_input_order) {
+    for (Pattern pattern : {Pattern::Random, Pattern::AllEqual, Pattern::FewDistinct}) {
+        for (SortAlgorithm algorithm : {SortAlgorithm::Auto, SortAlgorithm::QuickSort,
+                                        SortAlgorithm::KeyIndex, SortAlgorithm::Radix}) {
+            for (size_t threads : {1, 4}) {
+                for (size_t record_length : {16, 300}) {
+                    const size_t count = (record_length == 16) ? 100000 : 5000;
+                    auto data = make_input(pattern, count, record_length);
+
+                    SortEngine::Config config;
+                    config.record_length = record_length;
+                    config.thread_count = threads;
+                    config.keys = kTwoKeys;
+                    config.algorithm = algorithm;
+                    config.stable = true;
+                    SortEngine engine(config);
+                    ASSERT(engine.selected_algorithm(count) != SortAlgorithm::QuickSort);
+
+                    std::vector<uint8_t> output(data.size());
+                    engine.sort(data.data(), output.data(), count);
+                    check_sorted(output, record_length, count);
+                    check_stable(output, record_length, count);
+
+                    data = make_input(pattern, count, record_length);
+                    engine.sort(data.data(), count);
+                    check_stable(data, record_length, count);
+                }
+            }
+        }
+    }
+}
+
+TEST(adaptive_presorted_inputs) {
+    for (Pattern pattern : {Pattern::Sorted, Pattern::Reversed, Pattern::SortedWithTail,
+                            Pattern::FewRuns, Pattern::DescendingTies, Pattern::OrganPipe}) {
+        for (size_t threads : {1, 4}) {
+            for (bool stable : {false, true}) {
+                for (size_t count : {2, 3, 1000, 300000}) {
+                    const auto input = make_input(pattern, count, 16);
+
+                    SortEngine::Config config;
+                    config.record_length = 16;
+                    config.thread_count = threads;
+                    config.keys = kTwoKeys;
+                    config.stable = stable;
+                    SortEngine engine(config);
+                    if (count >= 1000) {
+                        ASSERT(engine.is_sorted(input.data(), count) == (pattern == Pattern::Sorted));
+                    }
+
+                    auto data = input;
+                    engine.sort(data.data(), count);
+                    check_sorted(data, 16, count);
+                    if (stable) check_stable(data, 16, count);
+                    if (pattern == Pattern::Sorted) {
+                        ASSERT(data == input);
+                    }
+
+                    data = input;
+                    std::vector<uint8_t> output(data.size());
+                    engine.sort(data.data(), output.data(), count);
+                    check_sorted(output, 16, count);
+                    if (stable) check_stable(output, 16, count);
+                }
+            }
+        }
+    }
+}
+
+TEST(top_k_matches_sorted_prefix) {
+    InterpretedComparator reference(kTwoKeys);
+    for (Pattern pattern : kPatterns) {
+        for (size_t threads : {1, 3}) {
+            const size_t count = 100000;
+            auto data = make_input(pattern, count, 16);
+            auto sorted = data;
+
+            SortEngine::Config config;
+            config.record_length = 16;
+            config.thread_count = threads;
+            config.keys = kTwoKeys;
+            SortEngine engine(config);
+            engine.sort(sorted.data(), count);
+
+            for (size_t limit : {1, 10, 5000, 100000, 250000}) {
+                // Blocks of uneven size, as read from a stream
+                TopK top(16, limit, engine);
+                for (size_t begin = 0; begin < count; begin += 37000) {
+                    top.add(data.data() + begin * 16, std::min<size_t>(37000, count - begin));
+                }
+                const size_t selected = top.selected_count();
+                ASSERT(selected == std::min(limit, count));
+
+                std::vector<uint8_t> result(selected * 16);
+                top.finish(result.data());
+                std::vector<uint64_t> seen;
+                for (size_t i = 0; i < selected; ++i) {
+                    ASSERT(reference.compare(result.data() + i * 16, sorted.data() + i * 16) == 0);
+                    uint64_t seq;
+                    std::memcpy(&seq, result.data() + i * 16 + 8, 8);
+                    seen.push_back(seq);
+                }
+                std::sort(seen.begin(), seen.end());
+                ASSERT(std::adjacent_find(seen.begin(), seen.end()) == seen.end());
+            }
+        }
+    }
+}
+
+TEST(stable_top_k_keeps_first_of_equal_records) {
+    const size_t count = 100000;
+    auto data = make_input(Pattern::FewDistinct, count, 16);
+    auto sorted = data;
+
+    SortEngine::Config config;
+    config.record_length = 16;
+    config.thread_count = 3;
+    config.keys = kTwoKeys;
+    config.stable = true;
+    SortEngine engine(config);
+    engine.sort(sorted.data(), count);
+
+    // A stable top-K is exactly the prefix of the stable sort
+    for (size_t limit : {1, 700, 30000}) {
+        TopK top(16, limit, engine);
+        top.add(data.data(), count);
+        std::vector<uint8_t> result(limit * 16);
+        top.finish(result.data());
+        ASSERT(std::memcmp(result.data(), sorted.data(), result.size()) == 0);
+    }
+}
+
+TEST(simd_kernels_match_scalar) {
+    std::mt19937_64 gen(11);
+    const KeyNormalizer normalizer(kTwoKeys);
+    // Window at offset 8: the last record's 16-byte load would overrun
+    const KeyNormalizer sequence({{9, 8, KeyType::BigEndianInt, SortOrder::Descending}});
+    const KeyNormalizer floats({{3, 4, KeyType::LittleEndianFloat, SortOrder::Ascending}});
+
+    for (int l = 0; l <= static_cast<int>(detected_simd_level()); ++l) {
+        const auto level = static_cast<SimdLevel>(l);
+
+        ASSERT(!PrefixGather(floats, level).vectorized());
+        for (const KeyNormalizer* keys : {&normalizer, &sequence}) {
+            const PrefixGather gather(*keys, level);
+            ASSERT(gather.vectorized() == (level != SimdLevel::Scalar));
+            for (size_t record_length : {16, 19, 40}) {
+                const size_t count = 1001;
+                const auto data = make_input(Pattern::Random, count, record_length);
+                std::vector<KeyIndexSort::Entry> entries(count);
+                gather.build(data.data(), record_length, count, 3, count, entries.data() + 3);
+                for (size_t i = 3; i < count; ++i) {
+                    ASSERT(entries[i].index == i);
+                    ASSERT(entries[i].prefix == keys->prefix(data.data() + i * record_length));
+                }
+            }
+        }
+
+        {
+            const size_t record_length = 19;
+            const size_t count = 4003;
+            const auto data = make_input(Pattern::FewDistinct, count, record_length);
+            std::vector<size_t> bytes(256, 0);
+            std::vector<size_t> digits(8 * 256, 0);
+            count_bytes(data.data() + 4, record_length, count, 0x80, bytes.data(), level);
+            count_key_bytes(data.data(), record_length, count, digits.data(), level);
+            for (size_t i = 0; i < count; ++i) {
+                const uint8_t* rec = data.data() + i * record_length;
+                bytes[rec[4] ^ 0x80]--;
+                uint64_t key;
+                std::memcpy(&key, rec, sizeof(key));
+                for (size_t d = 0; d < 8; ++d) {
+                    digits[256 * d + ((key >> (8 * d)) & 0xff)]--;
+                }
+            }
+            ASSERT(std::all_of(bytes.begin(), bytes.end(), [](size_t n) { return n == 0; }));
+            ASSERT(std::all_of(digits.begin(), digits.end(), [](size_t n) { return n == 0; }));
+        }
+
+        for (size_t count : {0, 1, 7, 33, 1000, 100000}) {
+            std::vector<KeyIndexSort::Entry> entries(count);
+            for (size_t i = 0; i < count; ++i) {
+                // Half the prefixes collide, leaving the index to decide
+                const uint64_t prefix = (i % 2 == 0) ? gen() % 16 : gen();
+                entries[i] = {prefix, (i * 7919) % count};
+            }
+            auto expected = entries;
+            std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+                return a.prefix != b.prefix ? a.prefix < b.prefix : a.index < b.index;
+            });
+            sort_entries_by_prefix(entries.data(), count, level);
+            for (size_t i = 0; i < count; ++i) {
+                ASSERT(entries[i].prefix == expected[i].prefix && entries[i].index == expected[i].index);
+            }
+        }
+    }
+}
+
+TEST(specialized_layouts_match_interpreter) {
+    const std::vector<KeySpec> keys = {
+        {1, 8, KeyType::LittleEndianInt, SortOrder::Ascending},
+        {9, 8, KeyType::LittleEndianInt, SortOrder::Ascending},
+    };
+    ASSERT(find_specialized_layout(keys, 16) != nullptr);
+    ASSERT(find_specialized_layout(keys, 24) == nullptr);
+    ASSERT(find_specialized_layout(kTwoKeys, 16) == nullptr);
+
+    const SpecializedLayout* layout = find_specialized_layout(keys, 16);
+    InterpretedComparator reference(keys);
+    const auto pairs = make_input(Pattern::FewDistinct, 2000, 16);
+    for (size_t i = 0; i + 1 < 2000; ++i) {
+        const uint8_t* a = pairs.data() + i * 16;
+        const int expected = reference.compare(a, a + 16);
+        const int actual = layout->compare(a, a + 16, nullptr);
+        ASSERT((expected > 0) - (expected < 0) == (actual > 0) - (actual < 0));
+    }
+
+    // Large ranges of equal keys fork instead of sorting serially
+    ThreadPool pool(4);
+    for (Pattern pattern : {Pattern::AllEqual, Pattern::FewDistinct, Pattern::Random}) {
+        const size_t count = 200000;
+        auto data = make_input(pattern, count, 16);
+        layout->sort(data.data(), count, &pool);
+        check_sorted(data, 16, count, keys);
+    }
+
+    // Quicksort below the sample sort cutoff, sample sort buckets above
+    for (Pattern pattern : kPatterns) {
+        for (size_t threads : {1, 4}) {
+            for (size_t count : {40000, 100000}) {
+                for (bool specialize : {true, false}) {
+                    auto data = make_input(pattern, count, 16);
+                    SortEngine::Config config;
+                    config.record_length = 16;
+                    config.thread_count = threads;
+                    config.keys = keys;
+                    config.algorithm = SortAlgorithm::QuickSort;
+                    config.specialize = specialize;
+                    SortEngine engine(config);
+                    ASSERT(engine.specialized() == specialize);
+                    engine.sort(data.data(), count);
+                    check_sorted(data, 16, count, keys);
+                }
+            }
+        }
+    }
+}
+
+void run_sort_engine_tests() {
+    RUN_TEST(quicksort_patterns);
+    RUN_TEST(sample_sort_record_sizes);
+    RUN_TEST(quicksort_wide_records);
+    RUN_TEST(parallel_quicksort_patterns);
+    RUN_TEST(parallel_sort_patterns);
+    RUN_TEST(parallel_wide_records);
+    RUN_TEST(shared_pool_across_engines);
+    RUN_TEST(out_of_place_sort);
+    RUN_TEST(key_index_patterns);
+    RUN_TEST(radix_patterns);
+    RUN_TEST(radix_float_keys);
+    RUN_TEST(simd_kernels_match_scalar);
+    RUN_TEST(specialized_layouts_match_interpreter);
+    RUN_TEST(stable_sort_keeps_input_order);
+    RUN_TEST(adaptive_presorted_inputs);
+    RUN_TEST(top_k_matches_sorted_prefix);
+    RUN_TEST(stable_top_k_keeps_first_of_equal_records);
+}
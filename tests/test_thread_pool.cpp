@@ -0,0 +1,82 @@
+// Thread pool tests
+// Fork-join completion, nested groups, exceptions and reuse
+
+#include "test_framework.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <vector>
+
+using namespace binsort;
+
+namespace {
+
+// Forks both halves of [begin, end) until ranges are small
+uint64_t forked_sum(ThreadPool& pool, uint64_t begin, uint64_t end) {
+    if (end - begin <= 64) {
+        uint64_t sum = 0;
+        for (uint64_t i = begin; i < end; ++i) sum += i;
+        return sum;
+    }
+    const uint64_t mid = begin + (end - begin) / 2;
+    uint64_t left = 0;
+    ThreadPool::TaskGroup group(pool);
+    group.run([&]() { left = forked_sum(pool, begin, mid); });
+    const uint64_t right = forked_sum(pool, mid, end);
+    group.wait();
+    return left + right;
+}
+
+} // namespace
+
+TEST(pool_parallel_for_runs_every_index) {
+    for (size_t threads : {1, 2, 5}) {
+        ThreadPool pool(threads);
+        ASSERT(pool.size() == threads);
+
+        std::vector<std::atomic<int>> hits(1000);
+        pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+        for (const auto& hit : hits) {
+            ASSERT(hit.load() == 1);
+        }
+    }
+}
+
+TEST(pool_nested_groups) {
+    ThreadPool pool(4);
+    const uint64_t n = 200000;
+    ASSERT(forked_sum(pool, 0, n) == n * (n - 1) / 2);
+}
+
+TEST(pool_propagates_exceptions) {
+    ThreadPool pool(3);
+    bool thrown = false;
+    try {
+        pool.parallel_for(100, [](size_t i) {
+            if (i == 37) throw std::runtime_error("task failed");
+        });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    // The pool stays usable afterwards
+    std::atomic<size_t> count{0};
+    pool.parallel_for(50, [&](size_t) { count++; });
+    ASSERT(count.load() == 50);
+}
+
+TEST(pool_reused_across_many_small_jobs) {
+    ThreadPool pool(4);
+    std::atomic<size_t> count{0};
+    for (int job = 0; job < 2000; ++job) {
+        pool.parallel_for(4, [&](size_t) { count++; });
+    }
+    ASSERT(count.load() == 8000);
+}
+
+void run_thread_pool_tests() {
+    RUN_TEST(pool_parallel_for_runs_every_index);
+    RUN_TEST(pool_nested_groups);
+    RUN_TEST(pool_propagates_exceptions);
+    RUN_TEST(pool_reused_across_many_small_jobs);
+}